@@ -16,13 +16,47 @@
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include <climits>
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+#include <new>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 using namespace std;
 
 const int VMAX_NUM = 5000;		// constant integer, vertex number of the graph
 const int G1_DEGREE = 6;		// constant integer, degree of each vertex in graph type 1
 const double G2_PERCENT = 0.2;		// constant double number, percentage of connectivity in graph type 2
 const int MAX_WEIGHT = 20000000;	// constant integer, maximum weight value
+const int LINEAR_BASE_SIZE = 8;	// constant integer, edge number below which the linear-time algorithm stops splitting
+const int HEAP_DEGREE = 4;		// constant integer, number of children per slot of the heap in routing algorithm
+const int ARENA_BLOCK_SIZE = 1048576;	// constant integer, bytes of each block of a scratch arena
+const int PARALLEL_MIN_SIZE = 65536;	// constant integer, element number from which sorting uses all processors
+const int INDEX_MIN_DEGREE = 16;	// constant integer, list length from which a vertex keeps a hash index of its edges
+const int FILTER_BASE_SIZE = 65536;	// constant integer, edge number below which Filter-Kruskal sorts directly
+const int QUERY_CHUNK = 64;		// constant integer, queries handed to a worker of the query service at a time
+const int SERVER_BATCH = 65536;	// constant integer, queries of a request answered at a time by the server
+const unsigned SNAPSHOT_VERSION = 1;	// constant unsigned integer, version of the graph snapshot format
+const int GENERATE_BLOCK_ROWS = 256;	// constant integer, rows of the adjacency matrix drawn from one random stream
+const int GENERATE_ATTEMPTS = 16;	// constant integer, fresh tries of the d-regular generator before giving up
+const int BENCH_QUERIES = 10;	// constant integer, default source-target pairs per graph in the benchmark
+const int PERF_COUNTER_NUM = 6;	// constant integer, number of hardware counters read by perfCounters
+const int POOL_SLAB_MIN = 256;		// constant integer, node number of the first slab of a node pool
+const int POOL_SLAB_MAX = 1048576;	// constant integer, maximum node number of a slab of a node pool
 
 // Structure edge: structure to represent edges
 struct edge {
@@ -32,6 +66,215 @@ struct edge {
 };
 // END of edge
 
+// function to return the number of online processors
+int GetThreadNum()
+{
+	long k=sysconf(_SC_NPROCESSORS_ONLN);
+	return (k>0)?int(k):1;
+}
+
+// function to run task on k argument blocks of argsize bytes in parallel threads, block 0 on the calling thread
+void RunParallel(void *(*task)(void *), void *args, size_t argsize, int k)
+{
+	pthread_t *th=new pthread_t[k];
+	bool *started=new bool[k];
+	for(int i=1;i<k;i++) {
+		started[i]=(pthread_create(&th[i], NULL, task, (char*)args+i*argsize)==0);
+		if(!started[i]) {task((char*)args+i*argsize);}
+	}
+	task(args);
+	for(int i=1;i<k;i++) {
+		if(started[i]) {pthread_join(th[i], NULL);}
+	}
+	delete[] th;
+	delete[] started;
+}
+
+// function to compare edges by source and then target vertex
+bool EdgeBefore(const edge &x, const edge &y)
+{
+	return x.a<y.a || (x.a==y.a && x.b<y.b);
+}
+
+// Structure sortTask: slice of an edge array sorted by one thread
+struct sortTask {
+	edge *E;	// first edge of the slice
+	int len;	// edge number of the slice
+	bool (*less)(const edge &, const edge &);	// order of edges
+};
+// END of sortTask
+
+// function to sort one slice of edges, run by each thread of ParallelSortEdges
+void* SortEdgeSlice(void *arg)
+{
+	sortTask *T=(sortTask*)arg;
+	stable_sort(T->E, T->E+T->len, T->less);
+	return NULL;
+}
+
+// function to stable sort edges, large arrays are sorted in slices by all processors and merged
+void ParallelSortEdges(edge *E, int len, bool (*less)(const edge &, const edge &))
+{
+	int k=GetThreadNum();
+	if(len<PARALLEL_MIN_SIZE || k==1) {
+		stable_sort(E, E+len, less);
+		return;
+	}
+	sortTask *T=new sortTask[k];
+	int *bound=new int[k+1];
+	for(int i=0;i<=k;i++) {bound[i]=int((long long)len*i/k);}
+	for(int i=0;i<k;i++) {
+		T[i].E=E+bound[i];
+		T[i].len=bound[i+1]-bound[i];
+		T[i].less=less;
+	}
+	RunParallel(SortEdgeSlice, T, sizeof(sortTask), k);
+	for(int step=1;step<k;step*=2) {
+		for(int i=0;i+step<k;i+=2*step) {
+			int hi=(i+2*step<k)?bound[i+2*step]:bound[k];
+			inplace_merge(E+bound[i], E+bound[i+step], E+hi, less);
+		}
+	}
+	delete[] T;
+	delete[] bound;
+}
+
+// Structure radixTask: slice of an edge array handled by one thread in one pass of RadixSortEdges
+struct radixTask {
+	edge *src;	// edges read by the pass
+	edge *dst;	// edges written by the pass
+	int lo;		// first edge of the slice
+	int hi;		// edge past the last one of the slice
+	int shift;	// bit position of the digit of the pass
+	int count[256];	// edges of the slice per digit, then first destination per digit
+};
+// END of radixTask
+
+// function to return the radix key of an edge, ascending keys give decreasing weights
+unsigned RadixKey(const edge &x)
+{
+	return ~((unsigned)x.w^0x80000000u);
+}
+
+// function to count the digits of one slice, run by each thread of RadixSortEdges
+void* RadixCount(void *arg)
+{
+	radixTask *T=(radixTask*)arg;
+	for(int d=0;d<256;d++) {T->count[d]=0;}
+	for(int i=T->lo;i<T->hi;i++) {T->count[(RadixKey(T->src[i])>>T->shift)&255]++;}
+	return NULL;
+}
+
+// function to scatter one slice by digit, run by each thread of RadixSortEdges
+void* RadixScatter(void *arg)
+{
+	radixTask *T=(radixTask*)arg;
+	for(int i=T->lo;i<T->hi;i++) {
+		T->dst[T->count[(RadixKey(T->src[i])>>T->shift)&255]++]=T->src[i];
+	}
+	return NULL;
+}
+
+// function to stable sort edges by decreasing weight with a least-significant-digit radix sort,
+// tmp holds len edges; large arrays are counted and scattered in slices by all processors
+void RadixSortEdges(edge *E, int len, edge *tmp)
+{
+	int k=(len<PARALLEL_MIN_SIZE)?1:GetThreadNum();
+	radixTask *T=new radixTask[k];
+	edge *src=E;
+	edge *dst=tmp;
+	for(int shift=0;shift<32;shift+=8) {
+		for(int i=0;i<k;i++) {
+			T[i].src=src;
+			T[i].dst=dst;
+			T[i].lo=int((long long)len*i/k);
+			T[i].hi=int((long long)len*(i+1)/k);
+			T[i].shift=shift;
+		}
+		RunParallel(RadixCount, T, sizeof(radixTask), k);
+		// every edge has the same digit, nothing to do in this pass
+		bool same=false;
+		for(int d=0;d<256 && !same;d++) {
+			int c=0;
+			for(int i=0;i<k;i++) {c+=T[i].count[d];}
+			same=(c==len);
+		}
+		if(same) {continue;}
+		int sum=0;
+		for(int d=0;d<256;d++) {
+			for(int i=0;i<k;i++) {
+				int c=T[i].count[d];
+				T[i].count[d]=sum;
+				sum+=c;
+			}
+		}
+		RunParallel(RadixScatter, T, sizeof(radixTask), k);
+		edge *swap=src; src=dst; dst=swap;
+	}
+	if(src!=E) {
+		for(int i=0;i<len;i++) {E[i]=src[i];}
+	}
+	delete[] T;
+}
+
+// Class randomStream: seeded xoshiro256** pseudo-random number generator
+// Streams with the same seed and different stream numbers are independent, so work split into numbered
+// blocks draws the same numbers whichever thread runs each block.
+class randomStream {
+	private:
+		unsigned long long state[4];	// generator state, never all zero
+		static unsigned long long SplitMix(unsigned long long &x);	// step a splitmix64 generator, used for seeding
+		static unsigned long long Rotate(unsigned long long x, int k);	// rotate x left by k bits
+	public:
+		randomStream(unsigned long long seed, unsigned long long stream=0);	// parameterized constructor
+		unsigned long long Next();	// return next 64 random bits
+		int Below(int n);		// return random integer in 0 .. n-1, n>0
+		double Uniform();		// return random double in [0, 1)
+};
+
+unsigned long long randomStream::SplitMix(unsigned long long &x)	// step a splitmix64 generator, used for seeding
+{
+	unsigned long long z=(x+=0x9E3779B97F4A7C15ULL);
+	z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+	z=(z^(z>>27))*0x94D049BB133111EBULL;
+	return z^(z>>31);
+}
+
+unsigned long long randomStream::Rotate(unsigned long long x, int k)	// rotate x left by k bits
+{
+	return (x<<k)|(x>>(64-k));
+}
+
+randomStream::randomStream(unsigned long long seed, unsigned long long stream)	// parameterized constructor
+{
+	unsigned long long x=seed^SplitMix(stream);
+	for(int i=0;i<4;i++) {state[i]=SplitMix(x);}
+}
+
+unsigned long long randomStream::Next()	// return next 64 random bits
+{
+	unsigned long long result=Rotate(state[1]*5, 7)*9;
+	unsigned long long t=state[1]<<17;
+	state[2]^=state[0];
+	state[3]^=state[1];
+	state[1]^=state[2];
+	state[0]^=state[3];
+	state[2]^=t;
+	state[3]=Rotate(state[3], 45);
+	return result;
+}
+
+int randomStream::Below(int n)	// return random integer in 0 .. n-1, n>0
+{
+	return int(((Next()>>32)*(unsigned long long)n)>>32);
+}
+
+double randomStream::Uniform()	// return random double in [0, 1)
+{
+	return (Next()>>11)*(1.0/9007199254740992.0);
+}
+// END of class randomStream
+
 // Class node: basic structure in linked list recording the data of each edge in graph  
 class node {
 	private:
@@ -102,14 +345,126 @@ void node::UpdateNextNode(node *p)	// update pointer value
 }
 // END of class node
 
+// Class nodePool: slab allocator handing out the list nodes of one graph
+class nodePool {
+	private:
+		struct slab {
+			node *nodes;	// memory of the slab
+			int count;	// node number of the slab
+			slab *next;	// slab allocated before this one
+		};
+		slab *slabs;	// most recent slab
+		int capacity;	// node number of the most recent slab
+		int used;	// nodes handed out from the most recent slab
+		node *freelist;	// nodes given back, linked through their next pointer
+		void AddSlab(int count);	// allocate a new slab of count nodes
+		nodePool(const nodePool &other);	// copying is not allowed
+		nodePool& operator=(const nodePool &other);	// copying is not allowed
+	public:
+		nodePool();	// default constructor
+		~nodePool();	// destructor
+		node* NewNode(const int v, const int w, node *p);	// return a node holding given data
+		void FreeNode(node *p);	// give back a single node
+		void Reserve(int count);	// make room for count more nodes in one slab
+		void Clear();	// give back all nodes at once
+		size_t MemoryBytes();	// return bytes held by the slabs
+};
+
+nodePool::nodePool()	// default constructor
+{
+	slabs=NULL;
+	capacity=0;
+	used=0;
+	freelist=NULL;
+}
+
+nodePool::~nodePool()	// destructor
+{
+	Clear();
+}
+
+void nodePool::AddSlab(int count)	// allocate a new slab of count nodes
+{
+	slab *s=new slab;
+	s->nodes=static_cast<node*>(operator new(sizeof(node)*count));
+	s->count=count;
+	s->next=slabs;
+	slabs=s;
+	capacity=count;
+	used=0;
+}
+
+node* nodePool::NewNode(const int v, const int w, node *p)	// return a node holding given data
+{
+	node *q;
+	if(freelist!=NULL) {
+		q=freelist;
+		freelist=freelist->GetNextNode();
+	} else {
+		if(used==capacity) {
+			int count=(capacity==0)?POOL_SLAB_MIN:2*capacity;
+			AddSlab((count<POOL_SLAB_MAX)?count:POOL_SLAB_MAX);
+		}
+		q=slabs->nodes+used;
+		used++;
+	}
+	return new(q) node(v, w, p);
+}
+
+void nodePool::FreeNode(node *p)	// give back a single node
+{
+	p->UpdateNextNode(freelist);
+	freelist=p;
+}
+
+void nodePool::Reserve(int count)	// make room for count more nodes in one slab
+{
+	if(count>capacity-used) {AddSlab(count);}
+}
+
+void nodePool::Clear()	// give back all nodes at once
+{
+	while(slabs!=NULL) {
+		slab *s=slabs;
+		slabs=slabs->next;
+		operator delete(s->nodes);
+		delete s;
+	}
+	capacity=0;
+	used=0;
+	freelist=NULL;
+}
+
+size_t nodePool::MemoryBytes()	// return bytes held by the slabs
+{
+	size_t bytes=0;
+	for(slab *s=slabs;s!=NULL;s=s->next) {bytes+=sizeof(slab)+sizeof(node)*s->count;}
+	return bytes;
+}
+// END of class nodePool
+
 // Class nodeList: a linked list to represent a sequence of edges connecting to certain vertex in graph
 class nodeList {
 	friend class graph;	// declaration of friend class
 	private:
 		node *head;	// header of linked list
 		int length;	// length of linked list
+		nodePool *pool;	// allocator of the nodes, NULL to use new and delete
+		node **index;	// open-addressing table from vertex to node, NULL while the list is short
+		int indexcap;	// slot number of index, a power of two
+		int indexused;	// slots of index ever filled, including removed ones
+		static node removed;	// marker of a removed slot in index
+		node* NewNode(const int v, const int w, node *p);	// allocate a node
+		void FreeNode(node *p);	// release a node
+		void BuildIndex();	// rebuild index from all nodes of the list
+		void DropIndex();	// release index
+		void IndexInsert(node *p);	// add node p to index
+		node** IndexSlot(int v);	// return slot of index holding vertex v, NULL if not found
 	protected:
 		void ResetList();	// Reset all data of the list
+		void DropList();	// forget all nodes without releasing them
+		void PushNode(int v, int w);	// add vertex with weights to the list without checking duplicates
+		void UpdateIndex();	// build index if pushed nodes made the list long enough
 		node* GetHead();	// return the header
 		int GetLength();	// return the length
 	public:
@@ -121,7 +476,9 @@ class nodeList {
 		bool AddNode(int v, int w); 	// add specified vertex with weights to the list
 		bool DeleteNode(int v);		// delete specified vertex from the list
 		int GetWeight(int v);		// return weight of specified edge
+		bool UpdateWeight(int v, int w);	// update weight of specified edge
 		void TraverseNodes();		// traverse all nodes of the list
+		size_t MemoryBytes();		// return bytes held by the list, nodes from a pool are counted by the pool
 };
 
 void nodeList::TraverseNodes()	// traverse all nodes of the list
@@ -146,37 +503,41 @@ nodeList& nodeList::operator=(const nodeList &other)	// copy assignment
 		head=NULL;
 	} else {
 		othercurrent=other.head;
-		head= new node(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
+		head= NewNode(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
 		othercurrent=othercurrent->GetNextNode();
 		current=head;
 		while(othercurrent!=NULL) {
-			newnode= new node(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
+			newnode= NewNode(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
 			current->UpdateNextNode(newnode);
 			othercurrent=othercurrent->GetNextNode();
 			current=current->GetNextNode();
 		}
 	}
+	if(length>=INDEX_MIN_DEGREE) {BuildIndex();}
 	return *this;
 }
 
 nodeList::nodeList(const nodeList &other)	// copy constructor
 {
 	node *newnode, *current, *othercurrent;
+	pool=NULL;
+	index=NULL;
 	length=other.length;
 	if (other.head==NULL) {
 		head=NULL;
 	} else {
 		othercurrent=other.head;
-		head= new node(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
+		head= NewNode(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
 		othercurrent=othercurrent->GetNextNode();
 		current=head;
 		while(othercurrent!=NULL) {
-			newnode= new node(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
+			newnode= NewNode(othercurrent->GetVertex(), othercurrent->GetWeight(), NULL);
 			current->UpdateNextNode(newnode);
 			othercurrent=othercurrent->GetNextNode();
 			current=current->GetNextNode();
 		}
 	}
+	if(length>=INDEX_MIN_DEGREE) {BuildIndex();}
 }
 
 node* nodeList::GetHead() 	// return the header
@@ -184,10 +545,91 @@ node* nodeList::GetHead() 	// return the header
 	return head;
 }
 
+node nodeList::removed;
+
 nodeList::nodeList()	// default constructor
 {
 	head=NULL;
 	length=0;
+	pool=NULL;
+	index=NULL;
+}
+
+node* nodeList::NewNode(const int v, const int w, node *p)	// allocate a node
+{
+	if(pool!=NULL) {return pool->NewNode(v, w, p);}
+	else {return new node(v, w, p);}
+}
+
+void nodeList::FreeNode(node *p)	// release a node
+{
+	if(pool!=NULL) {pool->FreeNode(p);}
+	else {delete p;}
+}
+
+void nodeList::DropList()	// forget all nodes without releasing them
+{
+	DropIndex();
+	head=NULL;
+	length=0;
+}
+
+void nodeList::PushNode(int v, int w)	// add vertex with weights to the list without checking duplicates
+{
+	head=NewNode(v, w, head);
+	length++;
+	if(index!=NULL) {IndexInsert(head);}
+}
+
+void nodeList::UpdateIndex()	// build index if pushed nodes made the list long enough
+{
+	if(index==NULL && length>=INDEX_MIN_DEGREE) {BuildIndex();}
+}
+
+void nodeList::BuildIndex()	// rebuild index from all nodes of the list
+{
+	DropIndex();
+	indexcap=INDEX_MIN_DEGREE;
+	while(indexcap<2*length) {indexcap*=2;}
+	index=new node*[indexcap];
+	for(int i=0;i<indexcap;i++) {index[i]=NULL;}
+	indexused=0;
+	for(node* p=head;p!=NULL;p=p->GetNextNode()) {
+		int i=int(((unsigned)p->GetVertex()*2654435761u)&(indexcap-1));
+		while(index[i]!=NULL) {i=(i+1)&(indexcap-1);}
+		index[i]=p;
+		indexused++;
+	}
+}
+
+void nodeList::DropIndex()	// release index
+{
+	delete[] index;
+	index=NULL;
+	indexcap=0;
+	indexused=0;
+}
+
+void nodeList::IndexInsert(node *p)	// add node p to index
+{
+	if(4*(indexused+1)>3*indexcap) {
+		BuildIndex();
+		return;
+	}
+	int i=int(((unsigned)p->GetVertex()*2654435761u)&(indexcap-1));
+	while(index[i]!=NULL && index[i]!=&removed) {i=(i+1)&(indexcap-1);}
+	if(index[i]==NULL) {indexused++;}
+	index[i]=p;
+}
+
+node** nodeList::IndexSlot(int v)	// return slot of index holding vertex v, NULL if not found
+{
+	int i=int(((unsigned)v*2654435761u)&(indexcap-1));
+	while(index[i]!=NULL) {
+		if(index[i]!=&removed && index[i]->GetVertex()==v) {return &index[i];}
+		i=(i+1)&(indexcap-1);
+	}
+	return NULL;
 }
 
 nodeList::~nodeList()	// destructor
@@ -204,10 +646,11 @@ void nodeList::ResetList()	// Reset all data of the list
 		while(current!= NULL) {
 			tmp=current;
 			current=current->GetNextNode();
-			delete(tmp);
+			FreeNode(tmp);
 		}
 		length=0;
 	}
+	DropIndex();
 }
 
 int nodeList::GetLength()	// return the length
@@ -217,6 +660,10 @@ int nodeList::GetLength()	// return the length
 
 node* nodeList::SearchNode(int v)	// search specified vertex in the list
 {
+	if(index!=NULL) {
+		node **slot=IndexSlot(v);
+		return (slot!=NULL)?*slot:NULL;
+	}
 	node *current=head;
 	while(current!=NULL) {
 		if(current->GetVertex()==v) return(current);
@@ -229,9 +676,11 @@ bool nodeList::AddNode(int v, int w)	// add specified vertex with weights to the
 {
 	if(SearchNode(v)==NULL) {
 		node *newnode;
-		newnode = new node(v, w, head);
+		newnode = NewNode(v, w, head);
 		head=newnode;
 		length++;
+		if(index!=NULL) {IndexInsert(head);}
+		else if(length>=INDEX_MIN_DEGREE) {BuildIndex();}
 		return true;
 	} else {
 		return false;
@@ -240,25 +689,31 @@ bool nodeList::AddNode(int v, int w)	// add specified vertex with weights to the
 
 bool nodeList::DeleteNode(int v)	// delete specified vertex from the list
 {
-	node *current, *prev, *next;
-	if(SearchNode(v)!=NULL) {
-		if(head->GetVertex()==v) {
-			current=head;
-			head=current->GetNextNode();
-			delete(current);	
-		} else {
-			prev=head;
-			current=prev->GetNextNode();
-			next=current->GetNextNode();
-			while(current->GetVertex()!=v) {
-				prev=current;
-				current=next;
-				next=next->GetNextNode();
-			}
-			prev->UpdateNextNode(next);
-			delete(current);
+	node *current=SearchNode(v);
+	if(current!=NULL) {
+		if(index!=NULL) {*IndexSlot(v)=&removed;}
+		if(current!=head) {
+			// move the header into the node of v, then unlink the header
+			current->UpdateVertex(head->GetVertex());
+			current->UpdateWeight(head->GetWeight());
+			if(index!=NULL) {*IndexSlot(head->GetVertex())=current;}
 		}
+		current=head;
+		head=current->GetNextNode();
+		FreeNode(current);
 		length--;
+		if(index!=NULL && 2*length<INDEX_MIN_DEGREE) {DropIndex();}
+		return true;
+	} else {
+		return false;
+	}
+}
+
+bool nodeList::UpdateWeight(int v, int w)	// update weight of specified edge
+{
+	node* tmp=SearchNode(v);
+	if(tmp!=NULL) {
+		tmp->UpdateWeight(w);
 		return true;
 	} else {
 		return false;
@@ -274,13 +729,24 @@ int nodeList::GetWeight(int v)	// return weight of specified edge
 		return -1;
 	}
 }
+
+size_t nodeList::MemoryBytes()	// return bytes held by the list, nodes from a pool are counted by the pool
+{
+	size_t bytes=(pool==NULL)?length*sizeof(node):0;
+	if(index!=NULL) {bytes+=indexcap*sizeof(node*);}
+	return bytes;
+}
 // END of class nodeList
 
 //Class graph: data structure to represent directed graph
 class graph {
 	protected:
 		nodeList* list;	// pointer to array of linked lists
+		nodePool* pool;	// allocator shared by all linked lists
 		int size;	// total vertex number
+		void PushEdge(int source, int target, int weight);	// add edge without checking duplicates, call IndexEdges after
+		void IndexEdges();	// build the index of every list that pushed edges made long enough
+		void ReserveEdges(int count);	// make room for count more edges in the node pool
 	public:
 		graph();	// default constructor
 		~graph();	// destructor
@@ -290,12 +756,14 @@ class graph {
 		bool AddEdge(int source, int target, int weight);	// add edge from source to target with weight in graph
 		bool DeleteEdge(int source, int target);	// delete edge from source to target in graph
 		int GetWeight(int source, int target);		// return weight of edge from source to target
+		bool UpdateWeight(int source, int target, int weight);	// update weight of edge from source to target
 		int GetVertexNum();		// return total vertex number
 		int GetEdgeNum(int source);	// return number of edges starting from source
 		node* GetEdges(int source);	// return linked list of edges from source
 		void CleanAllEdges();		// reset the whole graph
 		void TraverseGraph();		// traverse the whole graph
 		int GetComMaxWeight(int i, int j);	// return the maximum weight of edges connecting to two vertices
+		size_t MemoryBytes();		// return bytes held by the lists, their indexes and the node pool
 };
 
 int graph::GetComMaxWeight(int i, int j)	// return the maximum weight of edges connecting to two vertices
@@ -322,6 +790,13 @@ graph::graph(const graph &other)	// copy constructor
 {
 	size=other.size;
 	list= new nodeList[size];
+	pool= new nodePool;
+	int total=0;
+	for (int i=0;i<size;i++) {
+		list[i].pool=pool;
+		total+=other.list[i].length;
+	}
+	pool->Reserve(total);
 	for (int i=0;i<size;i++) {
 		list[i]=other.list[i];
 	}
@@ -329,7 +804,11 @@ graph::graph(const graph &other)	// copy constructor
 
 graph::~graph()	// destructor
 {
+	for(int i=0; i<size; i++) {
+		list[i].DropList();
+	}
 	delete[] list;
+	delete pool;
 }
 
 node* graph::GetEdges(int source)	// return linked list of edges from source
@@ -340,20 +819,39 @@ node* graph::GetEdges(int source)	// return linked list of edges from source
 void graph::CleanAllEdges()		// reset the whole graph
 {
 	for(int i=0; i<size; i++) {
-		list[i].ResetList();
+		list[i].DropList();
 	}
+	pool->Clear();
 }
 
 graph::graph()	// default constructor
 {
 	list=NULL;
+	pool=new nodePool;
 	size=0;
 }
 
 graph::graph(const int i)	// parameterized constructor
 {
 	list=new nodeList[i];
+	pool=new nodePool;
 	size=i;
+	for(int k=0;k<i;k++) {list[k].pool=pool;}
+}
+
+void graph::PushEdge(int source, int target, int weight)	// add edge without checking duplicates, call IndexEdges after
+{
+	list[source].PushNode(target, weight);
+}
+
+void graph::IndexEdges()	// build the index of every list that pushed edges made long enough
+{
+	for(int i=0;i<size;i++) {list[i].UpdateIndex();}
+}
+
+void graph::ReserveEdges(int count)	// make room for count more edges in the node pool
+{
+	pool->Reserve(count);
 }
 
 int graph::GetEdgeNum(int source)	// return number of edges starting from source
@@ -398,20 +896,35 @@ int graph::GetWeight(int source, int target) 	// return weight of edge from sour
 		return -1;
 	}
 }
+
+bool graph::UpdateWeight(int source, int target, int weight)	// update weight of edge from source to target
+{
+	if (source<size && target<size) {
+		return list[source].UpdateWeight(target, weight);
+	} else {
+		return false;
+	}
+}
+
+size_t graph::MemoryBytes()	// return bytes held by the lists, their indexes and the node pool
+{
+	size_t bytes=size*sizeof(nodeList)+pool->MemoryBytes();
+	for(int i=0;i<size;i++) {bytes+=list[i].MemoryBytes();}
+	return bytes;
+}
 // END of class graph
 
 // Class undirGraph: data structure to represent undirected graph, derived from class graph
 class undirGraph: public graph {
-	private:
-		bool SeedGraphType1(int degree, int weight);	// seed to generate graph type 1
 	public:
 		undirGraph(const int i);	// parameterized constructor 1
 		undirGraph(const int i, edge* E, int len);	// parameterized constructor 2
 		bool AddEdge(int source, int target, int weight);	// add edge between source and target with weight in graph
+		int BulkLoad(edge* E, int len);	// add edges of an array at once, return number of edges added
 		bool DeleteEdge(int source, int target);	// delete edge between source and target in graph
-		void BuildGraphType1(int degree, int weight);	// generate graph type 1
-		void BuildGraphType2(double percent, int weight);	// generate graph type 2
-		void AddExtraEdgesForTest(int s, int t, int weight);	// add extra edges for path from s to t 
+		bool UpdateWeight(int source, int target, int weight);	// update weight of edge between source and target
+		bool BuildGraphType1(int degree, int weight, unsigned long long seed);	// generate graph type 1, false if none exists
+		void BuildGraphType2(double percent, int weight, unsigned long long seed);	// generate graph type 2
 		void CleanIthEdges(int i);	// delete all edges connecting to vertex i
 		int GetTotalEdgeNum();		// return total edge number in graph
 };
@@ -430,22 +943,55 @@ int undirGraph::GetTotalEdgeNum()	// return total edge number in graph
 void undirGraph::CleanIthEdges(int i)	// delete all edges connecting to vertex i
 {
 	if (i>=0 && i<size) {
-		for(int j=0;j<size;j++) {DeleteEdge(i, j);}
+		while(GetEdges(i)!=NULL) {DeleteEdge(i, GetEdges(i)->GetVertex());}
 	}
 }
 
 
-undirGraph::undirGraph(const int i, edge* E, int len)	// parameterized constructor 2
+undirGraph::undirGraph(const int i, edge* E, int len): graph(i)	// parameterized constructor 2
 {
-	list=new nodeList[i];
-	size=i;
-	for(int j=0;j<len;j++) {AddEdge(E[j].a, E[j].b, E[j].w);}
+	BulkLoad(E, len);
 }
 
-undirGraph::undirGraph(const int i)	// parameterized constructor 1
+int undirGraph::BulkLoad(edge* E, int len)	// add edges of an array at once, return number of edges added
+{
+	int noo=0;
+	for(int i=0;i<size;i++) {
+		if(GetEdgeNum(i)) {
+			for(int j=0;j<len;j++) {
+				if(E[j].a>=0 && E[j].b>=0 && AddEdge(E[j].a, E[j].b, E[j].w)) {noo++;}
+			}
+			return noo;
+		}
+	}
+	// empty graph, sort the valid edges and keep the first copy of each vertex pair
+	edge *S=new edge[len];
+	int Slen=0;
+	for(int j=0;j<len;j++) {
+		int a=E[j].a, b=E[j].b;
+		if(a>=0 && b>=0 && a<size && b<size && a!=b) {
+			S[Slen].a=min(a,b);
+			S[Slen].b=max(a,b);
+			S[Slen].w=E[j].w;
+			Slen++;
+		}
+	}
+	ParallelSortEdges(S, Slen, EdgeBefore);
+	for(int j=0;j<Slen;j++) {
+		if(noo==0 || S[j].a!=S[noo-1].a || S[j].b!=S[noo-1].b) {S[noo++]=S[j];}
+	}
+	ReserveEdges(2*noo);
+	for(int j=0;j<noo;j++) {
+		PushEdge(S[j].a, S[j].b, S[j].w);
+		PushEdge(S[j].b, S[j].a, S[j].w);
+	}
+	IndexEdges();
+	delete[] S;
+	return noo;
+}
+
+undirGraph::undirGraph(const int i): graph(i)	// parameterized constructor 1
 {
-	list=new nodeList[i];
-	size=i;
 }
 
 bool undirGraph::AddEdge(int source, int target, int weight)	// add edge between source and target with weight in graph
@@ -466,150 +1012,534 @@ bool undirGraph::DeleteEdge(int source, int target)	// delete edge between sourc
 	}
 }
 
-bool undirGraph::SeedGraphType1(int degree, int weight)	// seed to generate graph type 1
+bool undirGraph::UpdateWeight(int source, int target, int weight)	// update weight of edge between source and target
 {
-	srand(time(0));
-	int another;
-	int count=size;
-	for(int i=0; i<size; i++) {
-		while(GetEdgeNum(i)<degree) {
-			if(count+GetEdgeNum(i)<degree+1) {
-				return false;
-			}
-			another=rand() % size;	
-			if (GetEdgeNum(another)<degree) {
-				int n=rand()%weight + 1;
-				AddEdge(i, another, n);
-				if(GetEdgeNum(another)>=degree) {
-					count--;
-				}
-			} 
-			if(GetEdgeNum(i)>=degree) {
-				count--;	
-			}
-		}
+	if (source<size && target<size && source!=target) {
+		return list[source].UpdateWeight(target, weight) && list[target].UpdateWeight(source, weight);
+	} else {
+		return false;
 	}
-	return true;
 }
 
-void undirGraph::BuildGraphType1(int degree, int weight)	// generate graph type 1
-{
-	while(!SeedGraphType1(degree, weight)) {CleanAllEdges();}
-}
+// Structure generateTask: blocks of rows of the adjacency matrix whose edges one thread draws for BuildGraphType2
+struct generateTask {
+	int n;			// vertex number
+	double p;		// probability of each edge
+	int weight;		// maximum weight
+	unsigned long long seed;	// seed of the graph
+	int first;		// first block of the thread
+	int step;		// distance between blocks of the thread
+	vector<edge> *E;	// edges drawn by the thread
+};
+// END of generateTask
 
-void undirGraph::BuildGraphType2(double percent, int weight)	// generate graph type 2
+// function to draw the edges of every step-th block of rows, run by each thread of BuildGraphType2
+// Row i pairs vertex i with the vertices after it; the gap to the next edge in a row is geometric,
+// so only the edges drawn cost time, and every block has its own stream.
+void* GenerateEdgeRows(void *arg)
 {
-	srand(time(0));
-	int another;
-	int count=size;
-	int total=size;
-	for(int i=0; i<size; i++) {
-		while(GetEdgeNum(i)*1.0/(total-1)<percent) {
-			another=rand() % size;	
-			if(((count+GetEdgeNum(i)-1)*1.0/(total-1))<percent) {
-				if(GetEdgeNum(another)*1.0/(total-1)<percent) {
-					continue;
-				} else if (GetEdgeNum(another)<=int(ceil(percent*(total-1)))) {
-					int n=rand()%weight + 1;
-					AddEdge(i, another, n);
-				}
-			} else {
-				if (GetEdgeNum(another)*1.0/(total-1)<percent) {
-					int n=rand()%weight + 1;
-					AddEdge(i, another, n);
-					if((GetEdgeNum(another)*1.0/(total-1))>=percent) {
-						count--;
-					}
-				}
-			}
-			if((GetEdgeNum(i)*1.0/(total-1))>=percent) {
-				count--;	
+	generateTask *T=(generateTask*)arg;
+	double lq=(T->p<1)?log(1-T->p):0;
+	for(long long b=T->first;b*GENERATE_BLOCK_ROWS<T->n;b+=T->step) {
+		randomStream R(T->seed, b);
+		int last=int(min((long long)T->n, (b+1)*GENERATE_BLOCK_ROWS));
+		for(int i=int(b*GENERATE_BLOCK_ROWS);i<last;i++) {
+			long long j=i;
+			while(true) {
+				double skip=(T->p<1)?floor(log(1-R.Uniform())/lq):0;
+				if(skip>=T->n) {break;}
+				j+=1+(long long)skip;
+				if(j>=T->n) {break;}
+				edge e;
+				e.a=i;
+				e.b=int(j);
+				e.w=R.Below(T->weight)+1;
+				T->E->push_back(e);
 			}
 		}
 	}
+	return NULL;
 }
 
-
-void undirGraph::AddExtraEdgesForTest(int s, int t, int weight)	// add extra edges for path from s to t
+bool undirGraph::BuildGraphType1(int degree, int weight, unsigned long long seed)	// generate graph type 1, false if none exists
 {
-	bool A[size];
-	node *current;
-	int mark;
-	for(int i=0;i<size;i++) {A[i]=true;}
-	int v=s;
-	A[s]=false;
-	while(1) {
-		current=GetEdges(v);
-		while(current!=NULL) {
-			if(A[current->GetVertex()]==true && current->GetVertex()!=t) {
-				v=current->GetVertex();
-				A[v]=false;
-				break;
+	CleanAllEdges();
+	long long stubs=(long long)size*degree;
+	if(degree<0 || (degree>0 && degree>=size) || stubs%2!=0) {return false;}
+	if(degree==size-1) {
+		randomStream R(seed);
+		for(int i=0;i<size;i++) {
+			for(int j=i+1;j<size;j++) {AddEdge(i, j, R.Below(weight)+1);}
+		}
+		return true;
+	}
+	int *S=new int[stubs];
+	edge *E=new edge[stubs/2];
+	for(int attempt=0;attempt<GENERATE_ATTEMPTS;attempt++) {
+		// configuration model: deal degree copies of every vertex at random into pairs
+		randomStream R(seed, attempt);
+		for(long long i=0;i<stubs;i++) {S[i]=int(i/degree);}
+		for(long long i=stubs-1;i>0;i--) {
+			long long j=(long long)(R.Uniform()*(i+1));
+			int tmp=S[i]; S[i]=S[j]; S[j]=tmp;
+		}
+		int Elen=0;
+		long long badlen=0;
+		for(long long i=0;i<stubs;i+=2) {
+			int w=R.Below(weight)+1;
+			if(AddEdge(S[i], S[i+1], w)) {
+				E[Elen].a=S[i];
+				E[Elen].b=S[i+1];
+				E[Elen].w=w;
+				Elen++;
 			} else {
-				current=current->GetNextNode();
+				S[badlen++]=S[i];
+				S[badlen++]=S[i+1];
 			}
 		}
-		if (current==NULL) {
-			mark=-1;
-			for (int i=0;i<size;i++) {
-				if(A[i] && i!=t) {mark=i;break;}
-			}
-			if (mark==-1) {	AddEdge(v, t, rand()%weight + 1); break;}
-			else {
-				AddEdge(v, mark, rand()%weight + 1);
-				A[mark]=false;
-				v=mark;
+		// repair each self-loop or repeated pair u-v by trading it with an edge x-y for u-x and v-y
+		bool ok=true;
+		for(long long i=0;i<badlen && ok;i+=2) {
+			int u=S[i];
+			int v=S[i+1];
+			long long tries=0;
+			while(true) {
+				if(Elen==0 || ++tries>(long long)GENERATE_ATTEMPTS*size) {
+					ok=false;
+					break;
+				}
+				int j=R.Below(Elen);
+				int x=E[j].a;
+				int y=E[j].b;
+				if(R.Next()&1) {int tmp=x; x=y; y=tmp;}
+				if(u==x || u==y || v==x || v==y || SearchEdge(u, x) || SearchEdge(v, y)) {continue;}
+				DeleteEdge(x, y);
+				AddEdge(u, x, E[j].w);
+				E[j].a=u;
+				E[j].b=x;
+				E[Elen].a=v;
+				E[Elen].b=y;
+				E[Elen].w=R.Below(weight)+1;
+				AddEdge(v, y, E[Elen].w);
+				Elen++;
+				break;
 			}
 		}
+		if(ok) {
+			delete[] S;
+			delete[] E;
+			return true;
+		}
+		CleanAllEdges();
+	}
+	delete[] S;
+	delete[] E;
+	return false;
+}
+
+void undirGraph::BuildGraphType2(double percent, int weight, unsigned long long seed)	// generate graph type 2
+{
+	CleanAllEdges();
+	if(percent<=0 || size<2) {return;}
+	int k=((long long)size*size*percent<PARALLEL_MIN_SIZE)?1:GetThreadNum();
+	generateTask *T=new generateTask[k];
+	for(int i=0;i<k;i++) {
+		T[i].n=size;
+		T[i].p=percent;
+		T[i].weight=weight;
+		T[i].seed=seed;
+		T[i].first=i;
+		T[i].step=k;
+		T[i].E=new vector<edge>();
 	}
-	
+	RunParallel(GenerateEdgeRows, T, sizeof(generateTask), k);
+	vector<edge> E;
+	size_t total=0;
+	for(int i=0;i<k;i++) {total+=T[i].E->size();}
+	E.reserve(total);
+	for(int i=0;i<k;i++) {
+		E.insert(E.end(), T[i].E->begin(), T[i].E->end());
+		delete T[i].E;
+	}
+	delete[] T;
+	if(!E.empty()) {BulkLoad(&E[0], int(E.size()));}
 }
+
 // END of class undirGraph
 
-//Class maxHeap: data structure of max-heap for routing algorithm
-class maxHeap {
-	private:
-		int *H;	// array of object index
-		int *D;	// array of object weight
-		int length;	// current size of heap
-		int maxsize;	// max size of heap
-		bool Heapfy(int i);	// adjust the location of value not in correct max-heap order
-	public:
-		maxHeap();	// default constructor
-		maxHeap(const int i);	// parameterized constructor
-		int Max();		// return the index with maximum weight
-		bool Insert(int i, int v);	// insert an index with weight
-		bool Delete(int i);	// delete an index in ith slot of heap
-		int GetValue(int i);	// return the weight of index in ith slot of heap
-		int GetLength();	// return the current size of heap
-		bool UpdateValue(int i, int v);	// update the weight of ith slot in heap
-		void Renew();	// reset the heap
+// Structure parseTask: chunk of an edge-list file parsed by one thread
+struct parseTask {
+	const char *begin;	// first byte of the chunk, at the start of a line
+	const char *end;	// byte past the chunk, at the start of a line or the end of the file
+	vector<edge> *E;	// edges found in the chunk
+	int vertices;		// vertex number given by a DIMACS problem line, 0 if none
+	int maxv;		// largest vertex found in the chunk, -1 if none
+	long long bad;		// first line in the chunk that could not be parsed, as a byte offset, -1 if none
 };
+// END of parseTask
 
-bool maxHeap::UpdateValue(int i, int v)	// update the weight of ith slot in heap
+// function to read an integer at p without leading space, false if there is none or it does not fit in int
+bool ParseInt(const char *&p, const char *end, int &x)
 {
-	if (i>0 && i<=maxsize) {
-		int pos=-1;
-		for (int k=1;k<=length;k++) {
-			if(H[k]==i) {pos=k;break;}
-		}
-		if (pos!=-1) {
-			D[i]=v;
-			Heapfy(pos);
-		} else {
-			return false;
-		}	
-	} else {
-		return false;
+	while(p<end && (*p==' ' || *p=='\t')) {p++;}
+	bool neg=(p<end && *p=='-');
+	if(neg) {p++;}
+	if(p>=end || *p<'0' || *p>'9') {return false;}
+	long long v=0;
+	while(p<end && *p>='0' && *p<='9') {
+		v=v*10+(*p-'0');
+		if(v>INT_MAX) {return false;}
+		p++;
 	}
+	x=neg?int(-v):int(v);
+	return true;
 }
 
-int maxHeap::GetLength()	// return the current size of heap
+// function to parse the lines of one chunk of an edge list, run by each thread of LoadEdgeList
+// A line is "u v w" with vertices from 0, "a u v w" as in DIMACS with vertices from 1, "p sp n m" giving
+// the vertex number, or a comment starting with c, # or %; blank lines and self-loops are skipped.
+void* ParseEdgeChunk(void *arg)
 {
-	return length;
+	parseTask *T=(parseTask*)arg;
+	const char *p=T->begin;
+	while(p<T->end) {
+		const char *line=p;
+		const char *eol=(const char*)memchr(p, '\n', T->end-p);
+		if(eol==NULL) {eol=T->end;}
+		p=eol+1;
+		const char *q=line;
+		while(q<eol && (*q==' ' || *q=='\t' || *q=='\r')) {q++;}
+		if(q==eol || *q=='c' || *q=='#' || *q=='%') {continue;}
+		const char *lineEnd=eol;
+		if(lineEnd>q && lineEnd[-1]=='\r') {lineEnd--;}
+		edge e;
+		bool ok;
+		if(*q=='p') {
+			q++;
+			while(q<lineEnd && (*q==' ' || *q=='\t')) {q++;}
+			while(q<lineEnd && *q!=' ' && *q!='\t') {q++;}
+			int n, m;
+			ok=ParseInt(q, lineEnd, n) && ParseInt(q, lineEnd, m) && n>=0;
+			if(ok) {T->vertices=n;}
+		} else {
+			int base=0;
+			if(*q=='a') {
+				q++;
+				base=1;
+			}
+			ok=ParseInt(q, lineEnd, e.a) && ParseInt(q, lineEnd, e.b) && ParseInt(q, lineEnd, e.w);
+			e.a-=base;
+			e.b-=base;
+			ok=ok && e.a>=0 && e.b>=0 && e.a<INT_MAX && e.b<INT_MAX && e.w>=1 && e.w<INT_MAX;
+			if(ok && e.a!=e.b) {
+				T->E->push_back(e);
+				T->maxv=max(T->maxv, max(e.a, e.b));
+			}
+		}
+		while(ok && q<lineEnd && (*q==' ' || *q=='\t')) {q++;}
+		if(!ok || q!=lineEnd) {
+			T->bad=line-T->begin;
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+// function to read the edges of a text edge list at path into E, the vertex number is written to n
+// The file is mapped and split at line breaks into one chunk per processor, parsed in parallel.
+bool LoadEdgeList(const char *path, vector<edge> &E, int &n)
+{
+	int fd=open(path, O_RDONLY);
+	if(fd<0) {
+		cerr << "Cannot open "<<path<<": "<<strerror(errno)<<endl;
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st)!=0 || !S_ISREG(st.st_mode)) {
+		cerr << "Not a regular file: "<<path<<endl;
+		close(fd);
+		return false;
+	}
+	size_t len=st.st_size;
+	const char *data=NULL;
+	if(len>0) {
+		void *m=mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(m==MAP_FAILED) {
+			cerr << "Cannot map "<<path<<": "<<strerror(errno)<<endl;
+			close(fd);
+			return false;
+		}
+		madvise(m, len, MADV_SEQUENTIAL);
+		data=(const char*)m;
+	}
+	close(fd);
+	int k=(len<(size_t)PARALLEL_MIN_SIZE)?1:GetThreadNum();
+	parseTask *T=new parseTask[k];
+	const char *prev=data;
+	for(int i=0;i<k;i++) {
+		const char *end=data+len;
+		if(i+1<k) {
+			end=data+len/k*(i+1);
+			if(end<prev) {end=prev;}
+			const char *eol=(const char*)memchr(end, '\n', data+len-end);
+			end=(eol==NULL)?data+len:eol+1;
+		}
+		T[i].begin=prev;
+		T[i].end=end;
+		T[i].E=new vector<edge>();
+		T[i].vertices=0;
+		T[i].maxv=-1;
+		T[i].bad=-1;
+		prev=end;
+	}
+	RunParallel(ParseEdgeChunk, T, sizeof(parseTask), k);
+	bool ok=true;
+	size_t total=0;
+	n=0;
+	for(int i=0;i<k;i++) {
+		if(ok && T[i].bad>=0) {
+			const char *line=T[i].begin+T[i].bad;
+			long long number=1+count(data, line, '\n');
+			cerr << "Cannot parse line "<<number<<" of "<<path<<endl;
+			ok=false;
+		}
+		total+=T[i].E->size();
+		n=max(n, max(T[i].vertices, T[i].maxv+1));
+	}
+	if(ok) {
+		E.clear();
+		E.reserve(total);
+		for(int i=0;i<k;i++) {E.insert(E.end(), T[i].E->begin(), T[i].E->end());}
+	}
+	for(int i=0;i<k;i++) {delete T[i].E;}
+	delete[] T;
+	if(len>0) {munmap((void*)data, len);}
+	return ok;
+}
+
+// function to build a linked-list graph from a text edge list at path, NULL if the file cannot be read
+undirGraph* LoadGraph(const char *path)
+{
+	vector<edge> E;
+	int n;
+	if(!LoadEdgeList(path, E, n)) {return NULL;}
+	return new undirGraph(n, E.empty()?NULL:&E[0], int(E.size()));
+}
+
+class bottleneckIndex;
+
+// Class csrGraph: immutable compressed-sparse-row snapshot of an undirected graph for routing queries
+class csrGraph {
+	friend bool SaveSnapshot(const char *path, csrGraph &G, bottleneckIndex *I);
+	private:
+		int size;	// total vertex number
+		int *offset;	// edges of vertex v are stored in slots offset[v] .. offset[v+1]-1
+		int *adj;	// neighbor vertex of each slot
+		int *weight;	// edge weight of each slot
+		bool owner;	// whether the arrays are freed with the graph
+		csrGraph(const csrGraph &other);	// copying is not allowed
+		csrGraph& operator=(const csrGraph &other);	// copying is not allowed
+	public:
+		csrGraph(undirGraph &G);	// parameterized constructor 1, freeze a linked-list graph
+		csrGraph(int n, int *offset, int *adj, int *weight);	// parameterized constructor 2, use arrays kept alive by the caller
+		~csrGraph();	// destructor
+		int GetVertexNum();		// return total vertex number
+		int GetTotalEdgeNum();		// return total edge number in graph
+		int GetEdgeNum(int source);	// return number of edges starting from source
+		int GetBegin(int source);	// return first slot of edges starting from source
+		int GetEnd(int source);		// return slot past the last edge starting from source
+		int GetVertex(int i);		// return neighbor vertex stored in ith slot
+		int GetWeight(int i);		// return edge weight stored in ith slot
+		int CollectEdges(edge *E);	// write every edge once into E, return edge number
+		size_t MemoryBytes();		// return bytes of the arrays, whether owned or not
+};
+
+csrGraph::csrGraph(undirGraph &G)	// parameterized constructor 1, freeze a linked-list graph
+{
+	owner=true;
+	size=G.GetVertexNum();
+	offset=new int[size+1];
+	offset[0]=0;
+	for(int i=0;i<size;i++) {offset[i+1]=offset[i]+G.GetEdgeNum(i);}
+	adj=new int[offset[size]];
+	weight=new int[offset[size]];
+	for(int i=0;i<size;i++) {
+		int k=offset[i];
+		for(node* p=G.GetEdges(i);p!=NULL;p=p->GetNextNode()) {
+			adj[k]=p->GetVertex();
+			weight[k]=p->GetWeight();
+			k++;
+		}
+	}
+}
+
+csrGraph::csrGraph(int n, int *offset, int *adj, int *weight)	// parameterized constructor 2, use arrays kept alive by the caller
+{
+	owner=false;
+	size=n;
+	this->offset=offset;
+	this->adj=adj;
+	this->weight=weight;
+}
+
+csrGraph::~csrGraph()	// destructor
+{
+	if(!owner) {return;}
+	delete[] offset;
+	delete[] adj;
+	delete[] weight;
+}
+
+int csrGraph::GetVertexNum()	// return total vertex number
+{
+	return size;
+}
+
+int csrGraph::GetTotalEdgeNum()	// return total edge number in graph
+{
+	return offset[size]/2;
+}
+
+int csrGraph::GetEdgeNum(int source)	// return number of edges starting from source
+{
+	return offset[source+1]-offset[source];
+}
+
+int csrGraph::GetBegin(int source)	// return first slot of edges starting from source
+{
+	return offset[source];
+}
+
+int csrGraph::GetEnd(int source)	// return slot past the last edge starting from source
+{
+	return offset[source+1];
+}
+
+int csrGraph::GetVertex(int i)	// return neighbor vertex stored in ith slot
+{
+	return adj[i];
+}
+
+int csrGraph::GetWeight(int i)	// return edge weight stored in ith slot
+{
+	return weight[i];
+}
+
+int csrGraph::CollectEdges(edge *E)	// write every edge once into E, return edge number
+{
+	int Elen=0;
+	for(int i=0;i<size;i++) {
+		for(int k=offset[i];k<offset[i+1];k++) {
+			if(adj[k]>i) {
+				E[Elen].a=i;
+				E[Elen].b=adj[k];
+				E[Elen].w=weight[k];
+				Elen++;
+			}
+		}
+	}
+	return Elen;
+}
+
+size_t csrGraph::MemoryBytes()	// return bytes of the arrays, whether owned or not
+{
+	return (size+1+2*(size_t)offset[size])*sizeof(int);
+}
+// END of class csrGraph
+
+// build with -DSP_COUNT_OPS=1 to count the basic operations of the routing algorithms
+#ifndef SP_COUNT_OPS
+#define SP_COUNT_OPS 0
+#endif
+
+// Enumeration opKind: basic operations counted by opCounter
+enum opKind {
+	OP_RELAX=0,		// edge scanned from a settled vertex
+	OP_HEAP_INSERT=1,	// object added to a heap
+	OP_HEAP_UPDATE=2,	// key of an object in a heap raised
+	OP_HEAP_EXTRACT=3,	// object removed from a heap
+	OP_FRINGE_SCAN=4,	// fringe vertex looked at by the heapless search for its maximum
+	OP_FIND=5,		// Find call
+	OP_COMPRESS=6,		// parent pointer redirected by path compression
+	OP_UNION=7,		// Union call
+	OP_SELECT=8,		// SelectEdge call
+	OP_PARTITION=9,		// PartitionEdges pass
+	OP_KIND_NUM=10
+};
+// END of opKind
+
+// Structure opCounter: operation counts of the calling thread, every call compiles to nothing unless enabled
+template<bool enabled> struct opCounter {
+	static void Add(opKind k, long long x=1) {}	// count x operations of kind k
+	static void Clear() {}		// set all counts to zero
+	static long long Get(opKind k) {return -1;}	// return count of kind k, -1 if counting is disabled
+};
+
+template<> struct opCounter<true> {
+	static __thread long long count[OP_KIND_NUM];	// counts of the calling thread
+	static void Add(opKind k, long long x=1) {count[k]+=x;}	// count x operations of kind k
+	static void Clear() {memset(count, 0, sizeof(count));}	// set all counts to zero
+	static long long Get(opKind k) {return count[k];}	// return count of kind k
+};
+__thread long long opCounter<true>::count[OP_KIND_NUM];
+// END of opCounter
+
+typedef opCounter<SP_COUNT_OPS!=0> opCount;
+
+// function to return the name of operation kind k in benchmark output
+const char* OpName(int k)
+{
+	const char *names[OP_KIND_NUM]={"relaxations", "heap_inserts", "heap_updates", "heap_extracts", "fringe_scans",
+		"finds", "compressions", "unions", "selections", "partitions"};
+	return names[k];
+}
+
+//Class maxHeap: data structure of indexed d-ary max-heap for routing algorithm
+class maxHeap {
+	private:
+		int *H;	// array of object index
+		int *D;	// array of object weight
+		int *P;	// array of heap slot of each object index, 0 if not in heap
+		int length;	// current size of heap
+		int maxsize;	// max size of heap
+		int degree;	// number of children of each slot
+		void Swap(int i, int j);	// exchange the objects in ith and jth slot
+		bool Heapfy(int i);	// adjust the location of value not in correct max-heap order
+		maxHeap(const maxHeap &other);	// copying is not allowed
+		maxHeap& operator=(const maxHeap &other);	// copying is not allowed
+	public:
+		maxHeap();	// default constructor
+		maxHeap(const int i, const int d=2);	// parameterized constructor, d children per slot
+		~maxHeap();	// destructor
+		int Max();		// return the index with maximum weight
+		bool Insert(int i, int v);	// insert an index with weight
+		bool Delete(int i);	// delete an index in ith slot of heap
+		bool Remove(int i);	// delete index i from heap
+		bool Contains(int i);	// check whether index i is in heap
+		int GetValue(int i);	// return the weight of index i
+		int GetLength();	// return the current size of heap
+		bool UpdateValue(int i, int v);	// update the weight of index i in heap
+		void Renew();	// reset the heap
+		size_t MemoryBytes();	// return bytes held by the heap
+};
+
+bool maxHeap::UpdateValue(int i, int v)	// update the weight of index i in heap
+{
+	if (i>0 && i<=maxsize && P[i]!=0) {
+		opCount::Add(OP_HEAP_UPDATE);
+		D[i]=v;
+		return Heapfy(P[i]);
+	} else {
+		return false;
+	}
+}
+
+int maxHeap::GetLength()	// return the current size of heap
+{
+	return length;
 }
 
-int maxHeap::GetValue(int i)	// return the weight of index in ith slot of heap
+int maxHeap::GetValue(int i)	// return the weight of index i
 {
 	if (i>0 && i<=maxsize) {
 		return D[i];
@@ -618,66 +1548,88 @@ int maxHeap::GetValue(int i)	// return the weight of index in ith slot of heap
 	}
 }
 
+bool maxHeap::Contains(int i)	// check whether index i is in heap
+{
+	return i>0 && i<=maxsize && P[i]!=0;
+}
+
 maxHeap::maxHeap()	// default constructor
 {
 	H=NULL;
 	D=NULL;
+	P=NULL;
 	length=0;
 	maxsize=0;
+	degree=2;
 }
 
-maxHeap::maxHeap(const int i)	// parameterized constructor
+maxHeap::maxHeap(const int i, const int d)	// parameterized constructor, d children per slot
 {
+	degree=(d>=2)?d:2;
 	if(i>0) {
 		H=new int[i+1];
 		D=new int[i+1];
+		P=new int[i+1];
 		maxsize=i;
 		length=0;
-		for(int k=0;k<i+1;k++) {D[k]=-1;} 
+		for(int k=0;k<i+1;k++) {D[k]=-1; P[k]=0;}
 	} else {
 		H=NULL;
 		D=NULL;
+		P=NULL;
 		maxsize=0;
 		length=0;
 	}
 }
 
+maxHeap::~maxHeap()	// destructor
+{
+	delete[] H;
+	delete[] D;
+	delete[] P;
+}
+
 void maxHeap::Renew()	// reset the heap
 {
-	delete H;
-	delete D;
-	H=new int[maxsize+1];
-	D=new int[maxsize+1];
-	for(int k=0;k<maxsize+1;k++) {D[k]=-1;} 
+	for(int k=1;k<=length;k++) {
+		D[H[k]]=-1;
+		P[H[k]]=0;
+	}
 	length=0;
 }
 
+void maxHeap::Swap(int i, int j)	// exchange the objects in ith and jth slot
+{
+	int tmp=H[i];
+	H[i]=H[j];
+	H[j]=tmp;
+	P[H[i]]=i;
+	P[H[j]]=j;
+}
+
 bool maxHeap::Heapfy(int i)	// adjust the location of value not in correct max-heap order
 {
-	int h, tmp;
 	if (i>0 && i<=length) {
-		if(i>1 && D[H[i]]>D[H[i/2]]) {
-			h=i;
-			while(h>1 && D[H[h]]>D[H[h/2]]) {
-				tmp=H[h/2];
-				H[h/2]=H[h];
-				H[h]=tmp;
-				h=h/2;
+		int h=i;
+		int parent=(h-2)/degree+1;
+		if(h>1 && D[H[h]]>D[H[parent]]) {
+			while(h>1 && D[H[h]]>D[H[parent]]) {
+				Swap(h, parent);
+				h=parent;
+				parent=(h-2)/degree+1;
 			}
-		} else if (i<=length/2 && D[H[i]]<max(D[H[2*i]],D[H[2*i+1]])) {
-			h=i;
-			while(h<=length/2 && D[H[h]]<max(D[H[2*h]],D[H[2*h+1]])) {
-				if(D[H[2*h]]>=D[H[2*h+1]]) {
-					tmp=H[2*h];
-					H[2*h]=H[h];
-					H[h]=tmp;
-					h=2*h;
-				} else {
-					tmp=H[2*h+1];
-					H[2*h+1]=H[h];
-					H[h]=tmp;
-					h=2*h+1;
+		} else {
+			int first=degree*(h-1)+2;
+			while(first<=length) {
+				int last=(first+degree-1<length)?(first+degree-1):length;
+				int c=first;
+				for(int k=first+1;k<=last;k++) {
+					if(D[H[k]]>D[H[c]]) {c=k;}
 				}
+				if(D[H[c]]<=D[H[h]]) {break;}
+				Swap(h, c);
+				h=c;
+				first=degree*(h-1)+2;
 			}
 		}
 		return true;
@@ -696,10 +1648,12 @@ bool maxHeap::Insert(int i, int v)	// insert an index with weight
 	if (length==maxsize) {
 		return false;
 	} else {
-		if (i>0 && i<=maxsize) {
+		if (i>0 && i<=maxsize && P[i]==0) {
+			opCount::Add(OP_HEAP_INSERT);
 			D[i]=v;
 			length++;
 			H[length]=i;
+			P[i]=length;
 			return Heapfy(length);
 		} else {
 			return false;
@@ -710,776 +1664,2707 @@ bool maxHeap::Insert(int i, int v)	// insert an index with weight
 bool maxHeap::Delete(int i)	// delete an index in ith slot of heap
 {
 	if (i>0 && i<=length) {
-		H[i]=H[length];
-		length--;
-		if (length> 0) {return Heapfy(i);}
-		else {return true;}
+		opCount::Add(OP_HEAP_EXTRACT);
+		P[H[i]]=0;
+		if (i<length) {
+			H[i]=H[length];
+			P[H[i]]=i;
+			length--;
+			return Heapfy(i);
+		} else {
+			length--;
+			return true;
+		}
 	} else {
 		return false;
 	}
 }
-// END of class maxHeap
 
-// function to check any fringes in the graph
-bool ExistFringe(string* A, int len)
+bool maxHeap::Remove(int i)	// delete index i from heap
 {
-	for(int i=0;i<len;i++)	{
-		if (A[i]=="fringe") {return true;}
+	if (i>0 && i<=maxsize && P[i]!=0) {
+		return Delete(P[i]);
+	} else {
+		return false;
 	}
-	return false;
 }
 
-// function to find fringes with largest capacity in Dijkstra's algorithm
-int PickLargestFringe(string* A, int* W, int len)
+size_t maxHeap::MemoryBytes()	// return bytes held by the heap
 {
-	int cap=-999999;
-	int v=-1;
-	for(int i=0;i<len;i++)	{
-		if (A[i]=="fringe") {
-			if(W[i]>cap) {
-				cap=W[i];
-				v=i;
-			}
-		}
-	}
-	return v;
+	return (H!=NULL)?3*(maxsize+1)*sizeof(int):0;
 }
+// END of class maxHeap
 
-// Dijkstra's algorithm without using a heap structure
-int* Dijkstra(undirGraph &G, int s, int t)
+// Class radixHeap: monotone radix heap over unsigned keys, extracted keys never decrease
+class radixHeap {
+	private:
+		struct item {
+			unsigned key;	// key of the object
+			int id;		// object index
+		};
+		vector<item> bucket[33];	// bucket i holds keys whose highest bit differing from last is bit i-1
+		unsigned last;	// last extracted key
+		int length;	// current size of heap, including stale copies
+		int Bucket(unsigned key);	// return bucket of key
+	public:
+		radixHeap();	// default constructor
+		bool Insert(int i, unsigned key);	// insert an index with key, key must not be below the last extracted one
+		bool ExtractMin(int &i, unsigned &key);	// remove an index with minimum key
+		int GetLength();	// return the current size of heap
+		void Renew();	// reset the heap
+		size_t MemoryBytes();	// return bytes held by the buckets
+};
+
+radixHeap::radixHeap()	// default constructor
 {
-	int n=G.GetVertexNum();
-	int* Dad=new int[n];
-	int Cap[n];
-	string Status[n];
-	node* ptr;	
-	int v, w;
-	for (int i=0;i<n; i++) {
-		Status[i]="unseen";
-		Dad[i]=-1;
-	}
-	Status[s]="intree";
-	ptr=G.GetEdges(s);
-	for(node* p=ptr; p!=NULL; p=p->GetNextNode()) {
-		w=p->GetVertex();
-		Status[w]="fringe";
-		Dad[w]=s;
-		Cap[w]=p->GetWeight();
-	}
-	while(ExistFringe(Status, n)) {
-		v=PickLargestFringe(Status, Cap, n);
-		Status[v]="intree";
-		ptr=G.GetEdges(v);
-		for(node* p=ptr; p!=NULL; p=p->GetNextNode()) {
-			w=p->GetVertex();
-			if(Status[w]=="unseen") {
-				Status[w]="fringe";
-				Dad[w]=v;
-				Cap[w]=min(p->GetWeight(),Cap[v]);
-			} else if (Status[w]=="fringe" && Cap[w]<min(p->GetWeight(),Cap[v])) {
-				Dad[w]=v;
-				Cap[w]=min(p->GetWeight(),Cap[v]);
-			}
-		}
-		
-	}
-	return Dad;
-}  
+	last=0;
+	length=0;
+}
 
-// Dijkstra's algorithm using a max-heap structure
-int* ModifiedDijkstra(undirGraph &G, int s, int t)
+int radixHeap::Bucket(unsigned key)	// return bucket of key
 {
-	int n=G.GetVertexNum();
-	int* Dad=new int[n];
-	int Cap[n];
-	string Status[n];
-	node* ptr;	
-	int v, w;
-	maxHeap H(n);
-	for (int i=0;i<n; i++) {
-		Status[i]="unseen";
-		Dad[i]=-1;
-	}
-	Status[s]="intree";
-	ptr=G.GetEdges(s);
-	for(node* p=ptr; p!=NULL; p=p->GetNextNode()) {
-		w=p->GetVertex();
-		Status[w]="fringe";
-		Dad[w]=s;
-		Cap[w]=p->GetWeight();
-		H.Insert(w+1, Cap[w]);
-	}
-	while(H.GetLength()) {
-		v=H.Max()-1;
-		Status[v]="intree";
-		H.Delete(1);
-		ptr=G.GetEdges(v);
-		for(node* p=ptr; p!=NULL; p=p->GetNextNode()) {
-			w=p->GetVertex();
-			if(Status[w]=="unseen") {
-				Status[w]="fringe";
-				Dad[w]=v;
-				Cap[w]=min(p->GetWeight(),Cap[v]);
-				H.Insert(w+1, Cap[w]);
-			} else if (Status[w]=="fringe" && Cap[w]<min(p->GetWeight(),Cap[v])) {
-				Dad[w]=v;
-				Cap[w]=min(p->GetWeight(),Cap[v]);
-				H.UpdateValue(w+1, Cap[w]);
-			}
+	return (key==last)?0:(32-__builtin_clz(key^last));
+}
+
+bool radixHeap::Insert(int i, unsigned key)	// insert an index with key, key must not be below the last extracted one
+{
+	if(key<last) {return false;}
+	opCount::Add(OP_HEAP_INSERT);
+	item x;
+	x.key=key;
+	x.id=i;
+	bucket[Bucket(key)].push_back(x);
+	length++;
+	return true;
+}
+
+bool radixHeap::ExtractMin(int &i, unsigned &key)	// remove an index with minimum key
+{
+	if(length==0) {return false;}
+	opCount::Add(OP_HEAP_EXTRACT);
+	if(bucket[0].empty()) {
+		int b=1;
+		while(bucket[b].empty()) {b++;}
+		unsigned m=bucket[b][0].key;
+		for(size_t k=1;k<bucket[b].size();k++) {
+			if(bucket[b][k].key<m) {m=bucket[b][k].key;}
+		}
+		last=m;
+		for(size_t k=0;k<bucket[b].size();k++) {
+			bucket[Bucket(bucket[b][k].key)].push_back(bucket[b][k]);
 		}
+		bucket[b].clear();
 	}
-	return Dad;
+	i=bucket[0].back().id;
+	key=bucket[0].back().key;
+	bucket[0].pop_back();
+	length--;
+	return true;
 }
 
-// function Find in MakeSet-Find-Union operations
-int Find(int v, int n, int *Dad)
+int radixHeap::GetLength()	// return the current size of heap
 {
-	int w=v;
-	int S[n];
-	int Slen=0;
-	int u;
-	while(Dad[w]!=-1) {
-		S[Slen++]=w;
-		w=Dad[w];
-	}
-	while(Slen) {
-		u=S[--Slen];
-		Dad[u]=w;
-	}
-	return w;
+	return length;
 }
 
-// function Union in MakeSet-Find-Union operations
-bool Union(int r1, int r2, int *Dad, int *rank)
+void radixHeap::Renew()	// reset the heap
 {
-	if(rank[r1]>rank[r2]) {
-		Dad[r2]=r1;
-	} else if (rank[r1]<rank[r2]) {	
-		Dad[r1]=r2;
-	} else {
-		Dad[r2]=r1;
-		rank[r1]++;
-	}
+	for(int b=0;b<33;b++) {bucket[b].clear();}
+	last=0;
+	length=0;
 }
 
-// Kruskal's algorithm using a max-heap to sort edges
-int* Kruskal(undirGraph &G, int s, int t)
-{	    
-	const rlim_t kStackSize = 512 * 1024 * 1024;   // min stack size = 512 MB
-   	struct rlimit rl;
-   	int result;
-   	result = getrlimit(RLIMIT_STACK, &rl);
-   	if (result == 0)
-   	{
-   	    if (rl.rlim_cur < kStackSize)
-   	    {
-   	        rl.rlim_cur = kStackSize;
-   	        result = setrlimit(RLIMIT_STACK, &rl);
-   	        if (result != 0)
-   	        {
-   	            fprintf(stderr, "setrlimit returned result = %d\n", result);
-   	        }
-   	    }
-   	}
+size_t radixHeap::MemoryBytes()	// return bytes held by the buckets
+{
+	size_t bytes=0;
+	for(int b=0;b<33;b++) {bytes+=bucket[b].capacity()*sizeof(item);}
+	return bytes;
+}
+// END of class radixHeap
 
-	int n=G.GetVertexNum();
-	int V=G.GetTotalEdgeNum();
-	edge E[V];
-	int Elen=0;
-	edge T[n-1];
-	int Tlen=0;
-	node* ptr;
-	for(int i=0;i<n;i++) {
-		ptr=G.GetEdges(i);
-		for(node* p=ptr;p!=NULL;p=p->GetNextNode()) {
-			if(p->GetVertex()>i) {
-				E[Elen].a=i;
-				E[Elen].b=p->GetVertex();
-				E[Elen].w=p->GetWeight();
-				Elen++;
-			}
-		}
-	}
-	maxHeap H(Elen);
-	for(int i=0;i<Elen;i++) {
-		H.Insert(i+1, E[i].w);
-	}
-	int F[Elen];
-	int j=0;
-	while(H.GetLength()) {
-		F[j++]=H.Max()-1;
-		H.Delete(1);
-	}
-	int Dad[n], rank[n];
-	for(int i=0;i<n;i++) {
-		Dad[i]=-1;
-		rank[i]=0;
-	}
-	for(int i=0;i<Elen;i++) {
-		int r1=Find(E[F[i]].a, n, Dad);
-		int r2=Find(E[F[i]].b, n, Dad);
-		if(r1!=r2) {
-			T[Tlen++]=E[F[i]];
-			Union(r1, r2, Dad, rank);
-		}
-	}
-	int u;
-	string color[n];
-	int *P =new int[n];
+// Enumeration vertexStatus: state of each vertex during Dijkstra's algorithm
+enum vertexStatus {
+	UNSEEN=0,
+	FRINGE=1,
+	INTREE=2
+};
+// END of vertexStatus
+
+// Enumeration dfsColor: state of each vertex during depth-first search
+enum dfsColor {
+	WHITE=0,
+	GRAY=1,
+	BLACK=2
+};
+// END of dfsColor
+
+// Enumeration kruskalMode: way Kruskal's algorithm orders the edges
+enum kruskalMode {
+	KRUSKAL_SORT=0,		// radix sort all edges
+	KRUSKAL_FILTER=1	// Filter-Kruskal, drop edges inside a tree before sorting them
+};
+// END of kruskalMode
+
+// Class queryWorkspace: per-vertex state of Dijkstra's algorithm, sized once per graph and reused by queries
+class queryWorkspace {
+	friend int* Dijkstra(csrGraph &G, int s, int t, queryWorkspace &W);
+	friend int* ModifiedDijkstra(csrGraph &G, int s, int t, queryWorkspace &W);
+	friend int* BidirectionalDijkstra(csrGraph &G, int s, int t, queryWorkspace &F, queryWorkspace &B);
+	friend int* RadixDijkstra(csrGraph &G, int s, int t, queryWorkspace &W);
+	private:
+		int size;		// total vertex number
+		unsigned char *status;	// vertexStatus of each vertex
+		int *cap;		// capacity of best known path to each vertex
+		int *dad;		// parent of each vertex in the search tree
+		int *touched;		// vertices whose status is not UNSEEN
+		int touchlen;		// length of touched
+		int *fringe;		// fringe vertices for the search without heap
+		int *fpos;		// slot of each vertex in fringe
+		int fringelen;		// length of fringe
+		maxHeap heap;		// fringe vertices for the search with heap
+		radixHeap rheap;	// fringe vertices for the search with radix heap
+		void Touch(int v);	// mark vertex v as fringe and remember it for Reset
+		void PushFringe(int v);	// add vertex v to fringe list
+		void PopFringe(int v);	// remove vertex v from fringe list
+		queryWorkspace(const queryWorkspace &other);	// copying is not allowed
+		queryWorkspace& operator=(const queryWorkspace &other);	// copying is not allowed
+	public:
+		queryWorkspace(const int n);	// parameterized constructor
+		~queryWorkspace();	// destructor
+		void Reset();		// restore the state touched by the last query
+		int GetVertexNum();	// return total vertex number
+		int* GetDad();		// return parent array of the last query
+		int GetCap(int v);	// return capacity of vertex v in the last query
+		size_t MemoryBytes();	// return bytes held by the workspace, including its heaps
+};
+
+queryWorkspace::queryWorkspace(const int n): heap(n, HEAP_DEGREE)	// parameterized constructor
+{
+	size=n;
+	status=new unsigned char[n];
+	cap=new int[n];
+	dad=new int[n];
+	touched=new int[n];
+	fringe=new int[n];
+	fpos=new int[n];
 	for(int i=0;i<n;i++) {
-		color[i]="white";
-		P[i]=-1;
-	}
-	int S[n];
-	int Slen=0;
-	S[Slen++]=s;
-	while(Slen) {
-		u=S[--Slen];
-		color[u]="gray";
-		for(int i=0;i<Tlen;i++) {
-			if(T[i].a==u && color[T[i].b]=="white") {
-				S[Slen++]=T[i].b;
-				P[T[i].b]=T[i].a;
-			} else if(T[i].b==u && color[T[i].a]=="white") {
-				S[Slen++]=T[i].a;
-				P[T[i].a]=T[i].b;
-			}
-		}
-		color[u]="black";
+		status[i]=UNSEEN;
+		dad[i]=-1;
+		fpos[i]=0;
 	}
-	return P;
+	touchlen=0;
+	fringelen=0;
 }
 
-// function to find the median weight from a set of edges
-int Median(edge *E, int n, int k)
+queryWorkspace::~queryWorkspace()	// destructor
 {
-	if(n<=10) {
-		maxHeap H(n);
-		int S[n];
-		for(int i=0;i<n;i++) {
-			H.Insert(i+1, E[i].w);
-		}
-		for(int i=n;i>0;i--) {
-			S[i-1]=H.Max()-1;
-			H.Delete(1);
-		}
-		return E[S[k-1]].w;
-	}
-	int Slen_5=(n%5==0)?(n/5):(n/5+1);
-	edge Sn_5[Slen_5];
-	maxHeap H(n);
-	int S[5];
-	int j=1;
-	while(j<=n) {
-		H.Insert(j, E[j-1].w);
-		if(j%5==0) {
-			for(int i=5;i>0;i--) {
-				S[i-1]=H.Max()-1;
-				H.Delete(1);
-			}
-			Sn_5[j/5-1]=E[S[2]];
-			H.Renew();
-		}
-		j++;
-	}
-	if(n/5!=0) {
-		int h=H.GetLength();
-		for(int i=h;i>0;i--) {
-			S[i-1]=H.Max()-1;
-			H.Delete(1);
-		}
-		Sn_5[n/5]=E[S[h/2]];
-	}
-	int m=Median(Sn_5, Slen_5, int(ceil(Slen_5*1.0/2)));
-	int Slensmall=0;
-	int Slenlarge=0;
-	edge Ssmall[n], Slarge[n];
-	for(int i=0;i<n;i++) {
-		if(E[i].w<m) {Ssmall[Slensmall]=E[i];Slensmall++;}
-		else {Slarge[Slenlarge]=E[i];Slenlarge++;}
+	delete[] status;
+	delete[] cap;
+	delete[] dad;
+	delete[] touched;
+	delete[] fringe;
+	delete[] fpos;
+}
+
+void queryWorkspace::Reset()	// restore the state touched by the last query
+{
+	for(int i=0;i<touchlen;i++) {
+		status[touched[i]]=UNSEEN;
+		dad[touched[i]]=-1;
 	}
-	if(k<=Slensmall) {return Median(Ssmall, Slensmall, k);}
-	else {return Median(Slarge, Slenlarge, k-Slensmall);}
+	touchlen=0;
+	fringelen=0;
+	heap.Renew();
+	rheap.Renew();
 }
 
-// function to build path in a undirected graph for the linear-time algorithm
-int* BuildPath(undirGraph &G, int source, int target)
+void queryWorkspace::Touch(int v)	// mark vertex v as fringe and remember it for Reset
 {
-	int n=G.GetVertexNum();
-	int *Dad=new int[n];
+	status[v]=FRINGE;
+	touched[touchlen++]=v;
+}
+
+void queryWorkspace::PushFringe(int v)	// add vertex v to fringe list
+{
+	fpos[v]=fringelen;
+	fringe[fringelen++]=v;
+}
+
+void queryWorkspace::PopFringe(int v)	// remove vertex v from fringe list
+{
+	int last=fringe[--fringelen];
+	fringe[fpos[v]]=last;
+	fpos[last]=fpos[v];
+}
+
+int queryWorkspace::GetVertexNum()	// return total vertex number
+{
+	return size;
+}
+
+int* queryWorkspace::GetDad()	// return parent array of the last query
+{
+	return dad;
+}
+
+int queryWorkspace::GetCap(int v)	// return capacity of vertex v in the last query
+{
+	return cap[v];
+}
+
+size_t queryWorkspace::MemoryBytes()	// return bytes held by the workspace, including its heaps
+{
+	return size*(sizeof(unsigned char)+5*sizeof(int))+heap.MemoryBytes()+rheap.MemoryBytes();
+}
+// END of class queryWorkspace
+
+// Dijkstra's algorithm without using a heap structure, result is owned by the workspace
+// the search stops once t is settled, a negative t builds the whole tree
+int* Dijkstra(csrGraph &G, int s, int t, queryWorkspace &W)
+{
+	int v, w, c;
+	W.Reset();
+	W.Touch(s);
+	W.status[s]=INTREE;
+	W.cap[s]=INT_MAX;
+	v=s;
+	while(v!=-1 && v!=t) {
+		opCount::Add(OP_RELAX, G.GetEdgeNum(v));
+		for(int k=G.GetBegin(v); k<G.GetEnd(v); k++) {
+			w=G.GetVertex(k);
+			c=min(G.GetWeight(k),W.cap[v]);
+			if(W.status[w]==UNSEEN) {
+				W.Touch(w);
+				W.PushFringe(w);
+				W.dad[w]=v;
+				W.cap[w]=c;
+			} else if (W.status[w]==FRINGE && W.cap[w]<c) {
+				W.dad[w]=v;
+				W.cap[w]=c;
+			}
+		}
+		v=-1;
+		opCount::Add(OP_FRINGE_SCAN, W.fringelen);
+		for(int i=0;i<W.fringelen;i++) {
+			if(v==-1 || W.cap[W.fringe[i]]>W.cap[v]) {v=W.fringe[i];}
+		}
+		if(v!=-1) {
+			W.PopFringe(v);
+			W.status[v]=INTREE;
+		}
+	}
+	return W.dad;
+}
+
+// Dijkstra's algorithm using a max-heap structure, result is owned by the workspace
+// the search stops once t is settled, a negative t builds the whole tree
+int* ModifiedDijkstra(csrGraph &G, int s, int t, queryWorkspace &W)
+{
+	int v, w, c;
+	W.Reset();
+	W.Touch(s);
+	W.status[s]=INTREE;
+	W.cap[s]=INT_MAX;
+	v=s;
+	while(v!=-1 && v!=t) {
+		opCount::Add(OP_RELAX, G.GetEdgeNum(v));
+		for(int k=G.GetBegin(v); k<G.GetEnd(v); k++) {
+			w=G.GetVertex(k);
+			c=min(G.GetWeight(k),W.cap[v]);
+			if(W.status[w]==UNSEEN) {
+				W.Touch(w);
+				W.dad[w]=v;
+				W.cap[w]=c;
+				W.heap.Insert(w+1, c);
+			} else if (W.status[w]==FRINGE && W.cap[w]<c) {
+				W.dad[w]=v;
+				W.cap[w]=c;
+				W.heap.UpdateValue(w+1, c);
+			}
+		}
+		v=-1;
+		if(W.heap.GetLength()) {
+			v=W.heap.Max()-1;
+			W.heap.Delete(1);
+			W.status[v]=INTREE;
+		}
+	}
+	return W.dad;
+}
+
+// Bidirectional Dijkstra's algorithm using max-heaps, result is owned by workspace F
+// Both searches grow until one of them can no longer beat the best bottleneck found where they meet.
+int* BidirectionalDijkstra(csrGraph &G, int s, int t, queryWorkspace &F, queryWorkspace &B)
+{
+	int v, w, c;
+	int best=-1;
+	int ma=-1, mb=-1;
+	F.Reset();
+	B.Reset();
+	if(s==t) {return F.dad;}
+	F.Touch(s);
+	F.cap[s]=INT_MAX;
+	F.heap.Insert(s+1, INT_MAX);
+	B.Touch(t);
+	B.cap[t]=INT_MAX;
+	B.heap.Insert(t+1, INT_MAX);
+	while(F.heap.GetLength() && B.heap.GetLength()) {
+		if(F.cap[F.heap.Max()-1]<=best || B.cap[B.heap.Max()-1]<=best) {break;}
+		bool forward=(F.heap.GetLength()<=B.heap.GetLength());
+		queryWorkspace &X=forward?F:B;
+		queryWorkspace &Y=forward?B:F;
+		v=X.heap.Max()-1;
+		X.heap.Delete(1);
+		X.status[v]=INTREE;
+		opCount::Add(OP_RELAX, G.GetEdgeNum(v));
+		for(int k=G.GetBegin(v); k<G.GetEnd(v); k++) {
+			w=G.GetVertex(k);
+			c=min(G.GetWeight(k),X.cap[v]);
+			if(Y.status[w]!=UNSEEN && min(c, Y.cap[w])>best) {
+				best=min(c, Y.cap[w]);
+				ma=forward?v:w;
+				mb=forward?w:v;
+			}
+			if(X.status[w]==UNSEEN) {
+				X.Touch(w);
+				X.dad[w]=v;
+				X.cap[w]=c;
+				X.heap.Insert(w+1, c);
+			} else if (X.status[w]==FRINGE && X.cap[w]<c) {
+				X.dad[w]=v;
+				X.cap[w]=c;
+				X.heap.UpdateValue(w+1, c);
+			}
+		}
+	}
+	if(best==-1) {return F.dad;}
+	// join the two half paths in the fringe buffer of F, cutting any loop where they cross
+	int *seq=F.fringe;
+	int *at=F.fpos;
+	int len=0;
+	for(int x=ma; x!=-1; x=F.dad[x]) {seq[len++]=x;}
+	for(int i=0;i<len/2;i++) {
+		int tmp=seq[i]; seq[i]=seq[len-1-i]; seq[len-1-i]=tmp;
+	}
+	for(int i=0;i<len;i++) {at[seq[i]]=i;}
+	for(int x=mb; x!=-1; x=B.dad[x]) {
+		if(at[x]>=0 && at[x]<len && seq[at[x]]==x) {
+			len=at[x]+1;
+		} else {
+			at[x]=len;
+			seq[len++]=x;
+		}
+	}
+	for(int i=1;i<len;i++) {
+		if(F.status[seq[i]]==UNSEEN) {F.Touch(seq[i]);}
+		F.dad[seq[i]]=seq[i-1];
+	}
+	F.cap[t]=best;
+	return F.dad;
+}
+
+// Dijkstra's algorithm using a radix heap, result is owned by the workspace
+// keys are INT_MAX minus capacity, which only grow along the search since capacities only shrink;
+// a raised capacity is pushed again and the outdated copy is skipped when it comes out
+int* RadixDijkstra(csrGraph &G, int s, int t, queryWorkspace &W)
+{
+	int v, w, c;
+	unsigned key;
+	W.Reset();
+	W.Touch(s);
+	W.status[s]=INTREE;
+	W.cap[s]=INT_MAX;
+	v=s;
+	while(v!=-1 && v!=t) {
+		opCount::Add(OP_RELAX, G.GetEdgeNum(v));
+		for(int k=G.GetBegin(v); k<G.GetEnd(v); k++) {
+			w=G.GetVertex(k);
+			c=min(G.GetWeight(k),W.cap[v]);
+			if(W.status[w]==UNSEEN) {
+				W.Touch(w);
+				W.dad[w]=v;
+				W.cap[w]=c;
+				W.rheap.Insert(w, unsigned(INT_MAX-c));
+			} else if (W.status[w]==FRINGE && W.cap[w]<c) {
+				W.dad[w]=v;
+				W.cap[w]=c;
+				W.rheap.Insert(w, unsigned(INT_MAX-c));
+			}
+		}
+		v=-1;
+		while(W.rheap.ExtractMin(w, key)) {
+			if(W.status[w]==FRINGE && key==unsigned(INT_MAX-W.cap[w])) {
+				v=w;
+				W.status[v]=INTREE;
+				break;
+			}
+		}
+	}
+	return W.dad;
+}
+
+// function to copy the parent array out of a workspace
+int* CopyDad(queryWorkspace &W)
+{
+	int n=W.GetVertexNum();
+	int *Dad=new int[n];
+	int *src=W.GetDad();
+	for(int i=0;i<n;i++) {Dad[i]=src[i];}
+	return Dad;
+}
+
+// Dijkstra's algorithm without using a heap structure
+int* Dijkstra(csrGraph &G, int s, int t)
+{
+	queryWorkspace W(G.GetVertexNum());
+	Dijkstra(G, s, t, W);
+	return CopyDad(W);
+}
+
+// Dijkstra's algorithm using a max-heap structure
+int* ModifiedDijkstra(csrGraph &G, int s, int t)
+{
+	queryWorkspace W(G.GetVertexNum());
+	ModifiedDijkstra(G, s, t, W);
+	return CopyDad(W);
+}
+
+// Dijkstra's algorithm using a radix heap
+int* RadixDijkstra(csrGraph &G, int s, int t)
+{
+	queryWorkspace W(G.GetVertexNum());
+	RadixDijkstra(G, s, t, W);
+	return CopyDad(W);
+}
+
+// Bidirectional Dijkstra's algorithm using max-heaps
+int* BidirectionalDijkstra(csrGraph &G, int s, int t)
+{
+	queryWorkspace F(G.GetVertexNum());
+	queryWorkspace B(G.GetVertexNum());
+	BidirectionalDijkstra(G, s, t, F, B);
+	return CopyDad(F);
+}
+
+// Dijkstra's algorithm without using a heap structure, on a linked-list graph
+int* Dijkstra(undirGraph &G, int s, int t)
+{
+	csrGraph C(G);
+	return Dijkstra(C, s, t);
+}
+
+// Dijkstra's algorithm using a max-heap structure, on a linked-list graph
+int* ModifiedDijkstra(undirGraph &G, int s, int t)
+{
+	csrGraph C(G);
+	return ModifiedDijkstra(C, s, t);
+}
+
+// Dijkstra's algorithm using a radix heap, on a linked-list graph
+int* RadixDijkstra(undirGraph &G, int s, int t)
+{
+	csrGraph C(G);
+	return RadixDijkstra(C, s, t);
+}
+
+// Bidirectional Dijkstra's algorithm using max-heaps, on a linked-list graph
+int* BidirectionalDijkstra(undirGraph &G, int s, int t)
+{
+	csrGraph C(G);
+	return BidirectionalDijkstra(C, s, t);
+}
+
+// Structure arenaMark: position in a scratch arena to roll back to
+struct arenaMark {
+	void *blk;	// block in use
+	size_t used;	// bytes handed out from that block
+	size_t before;	// bytes handed out from the blocks before it
+};
+// END of arenaMark
+
+// Class scratchArena: bump allocator for the scratch buffers of queries, released all at once
+class scratchArena {
+	private:
+		struct block {
+			char *data;	// memory of the block
+			size_t size;	// capacity of the block
+			size_t used;	// bytes handed out from the block
+			block *next;	// next block, kept for reuse after a reset
+		};
+		block *head;	// first block
+		block *cur;	// block serving allocations
+		size_t before;	// bytes handed out from the blocks before cur
+		size_t peak;	// most bytes handed out at once since the last ResetPeak
+		scratchArena(const scratchArena &other);	// copying is not allowed
+		scratchArena& operator=(const scratchArena &other);	// copying is not allowed
+	public:
+		scratchArena();	// default constructor
+		~scratchArena();	// destructor
+		void* AllocBytes(size_t bytes);	// return 16-byte aligned scratch memory
+		template<class T> T* Alloc(size_t n);	// return scratch array of n objects
+		arenaMark GetMark();	// return current position
+		void Release(arenaMark m);	// give back everything allocated after position m
+		void Reset();	// give back everything
+		size_t GetPeakBytes();	// return most bytes handed out at once since the last ResetPeak
+		void ResetPeak();	// start measuring the peak from the current position
+		size_t MemoryBytes();	// return bytes held by the blocks
+};
+
+scratchArena::scratchArena()	// default constructor
+{
+	head=new block;
+	head->data=new char[ARENA_BLOCK_SIZE];
+	head->size=ARENA_BLOCK_SIZE;
+	head->used=0;
+	head->next=NULL;
+	cur=head;
+	before=0;
+	peak=0;
+}
+
+scratchArena::~scratchArena()	// destructor
+{
+	while(head!=NULL) {
+		block *tmp=head;
+		head=head->next;
+		delete[] tmp->data;
+		delete tmp;
+	}
+}
+
+void* scratchArena::AllocBytes(size_t bytes)	// return 16-byte aligned scratch memory
+{
+	bytes=(bytes+15)&~(size_t)15;
+	while(cur->used+bytes>cur->size && cur->next!=NULL) {
+		before+=cur->used;
+		cur=cur->next;
+		cur->used=0;
+	}
+	if(cur->used+bytes>cur->size) {
+		block *b=new block;
+		b->size=(bytes>(size_t)ARENA_BLOCK_SIZE)?bytes:ARENA_BLOCK_SIZE;
+		b->data=new char[b->size];
+		b->used=0;
+		b->next=NULL;
+		before+=cur->used;
+		cur->next=b;
+		cur=b;
+	}
+	void *p=cur->data+cur->used;
+	cur->used+=bytes;
+	if(before+cur->used>peak) {peak=before+cur->used;}
+	return p;
+}
+
+template<class T> T* scratchArena::Alloc(size_t n)	// return scratch array of n objects
+{
+	return (T*)AllocBytes(n*sizeof(T));
+}
+
+arenaMark scratchArena::GetMark()	// return current position
+{
+	arenaMark m;
+	m.blk=cur;
+	m.used=cur->used;
+	m.before=before;
+	return m;
+}
+
+void scratchArena::Release(arenaMark m)	// give back everything allocated after position m
+{
+	cur=(block*)m.blk;
+	cur->used=m.used;
+	before=m.before;
+}
+
+void scratchArena::Reset()	// give back everything
+{
+	cur=head;
+	cur->used=0;
+	before=0;
+}
+
+size_t scratchArena::GetPeakBytes()	// return most bytes handed out at once since the last ResetPeak
+{
+	return peak;
+}
+
+void scratchArena::ResetPeak()	// start measuring the peak from the current position
+{
+	peak=before+cur->used;
+}
+
+size_t scratchArena::MemoryBytes()	// return bytes held by the blocks
+{
+	size_t bytes=0;
+	for(block *b=head;b!=NULL;b=b->next) {bytes+=sizeof(block)+b->size;}
+	return bytes;
+}
+// END of class scratchArena
+
+// function Find in MakeSet-Find-Union operations
+int Find(int v, int n, int *Dad)
+{
+	int w=v;
+	int u;
+	opCount::Add(OP_FIND);
+	while(Dad[w]!=-1) {
+		w=Dad[w];
+	}
+	while(v!=w) {
+		u=Dad[v];
+		if(u!=w) {opCount::Add(OP_COMPRESS);}
+		Dad[v]=w;
+		v=u;
+	}
+	return w;
+}
+
+// function Union in MakeSet-Find-Union operations
+bool Union(int r1, int r2, int *Dad, int *rank)
+{
+	opCount::Add(OP_UNION);
+	if(rank[r1]>rank[r2]) {
+		Dad[r2]=r1;
+	} else if (rank[r1]<rank[r2]) {	
+		Dad[r1]=r2;
+	} else {
+		Dad[r2]=r1;
+		rank[r1]++;
+	}
+	return true;
+}
+
+void SelectEdge(edge *E, int n, int k);
+
+// function to add the edges of a maximum spanning forest of E to T in Kruskal's order, Filter-Kruskal variant
+// The heavier half is handled first, then edges of the lighter half that already close a cycle are dropped
+// before the rest is handled, so sorting is spent only on edges that may still join two trees.
+void FilterKruskal(edge *E, int m, int n, int *Dad, int *rank, edge *T, int &Tlen, scratchArena &A)
+{
+	while(m>0 && Tlen<n-1) {
+		if(m<=FILTER_BASE_SIZE) {
+			arenaMark mark=A.GetMark();
+			RadixSortEdges(E, m, A.Alloc<edge>(m));
+			A.Release(mark);
+			for(int i=0;i<m && Tlen<n-1;i++) {
+				int r1=Find(E[i].a, n, Dad);
+				int r2=Find(E[i].b, n, Dad);
+				if(r1!=r2) {
+					T[Tlen++]=E[i];
+					Union(r1, r2, Dad, rank);
+				}
+			}
+			return;
+		}
+		int h=m/2;
+		SelectEdge(E, m, h);
+		FilterKruskal(E, h+1, n, Dad, rank, T, Tlen, A);
+		int mNew=0;
+		for(int i=h+1;i<m;i++) {
+			if(Find(E[i].a, n, Dad)!=Find(E[i].b, n, Dad)) {E[mNew++]=E[i];}
+		}
+		m=mNew;
+	}
+}
+
+// function to find a maximum spanning forest of E over n vertices, its edges are written to T in Kruskal's order
+int MaxSpanningForest(edge *E, int Elen, int n, edge *T, scratchArena &A, kruskalMode mode)
+{
+	arenaMark mark=A.GetMark();
+	int Tlen=0;
+	int *Dad=A.Alloc<int>(n);
+	int *rank=A.Alloc<int>(n);
+	for(int i=0;i<n;i++) {
+		Dad[i]=-1;
+		rank[i]=0;
+	}
+	if(mode==KRUSKAL_FILTER) {
+		FilterKruskal(E, Elen, n, Dad, rank, T, Tlen, A);
+	} else {
+		RadixSortEdges(E, Elen, A.Alloc<edge>(Elen));
+		for(int i=0;i<Elen && Tlen<n-1;i++) {
+			int r1=Find(E[i].a, n, Dad);
+			int r2=Find(E[i].b, n, Dad);
+			if(r1!=r2) {
+				T[Tlen++]=E[i];
+				Union(r1, r2, Dad, rank);
+			}
+		}
+	}
+	A.Release(mark);
+	return Tlen;
+}
+
+// function to build the parent array of the spanning forest T rooted at s, vertices outside the tree of s get -1
+// The tree is put in adjacency arrays first, so the walk is linear; for t>=0 it stops once t is reached,
+// leaving parents only on the part of the tree walked so far, which includes the path from s to t.
+int* TreeParents(edge *T, int Tlen, int n, int s, int t, scratchArena &A)
+{
+	arenaMark mark=A.GetMark();
+	int *P =new int[n];
+	int *offset=A.Alloc<int>(n+1);
+	int *adj=A.Alloc<int>(2*Tlen);
+	unsigned char *color=A.Alloc<unsigned char>(n);
+	for(int i=0;i<=n;i++) {offset[i]=0;}
+	for(int i=0;i<Tlen;i++) {
+		offset[T[i].a+1]++;
+		offset[T[i].b+1]++;
+	}
+	for(int i=0;i<n;i++) {
+		offset[i+1]+=offset[i];
+		color[i]=WHITE;
+		P[i]=-1;
+	}
+	for(int i=0;i<Tlen;i++) {
+		adj[offset[T[i].a]++]=T[i].b;
+		adj[offset[T[i].b]++]=T[i].a;
+	}
+	// filling moved every offset to the end of its vertex, which is the start of the next one
+	for(int i=n;i>0;i--) {offset[i]=offset[i-1];}
+	offset[0]=0;
+	int *S=A.Alloc<int>(n);
+	int Slen=0;
+	S[Slen++]=s;
+	color[s]=GRAY;
+	while(Slen) {
+		int u=S[--Slen];
+		color[u]=BLACK;
+		if(u==t) {break;}
+		for(int i=offset[u];i<offset[u+1];i++) {
+			int v=adj[i];
+			if(color[v]==WHITE) {
+				color[v]=GRAY;
+				P[v]=u;
+				S[Slen++]=v;
+			}
+		}
+	}
+	A.Release(mark);
+	return P;
+}
+
+// Kruskal's algorithm using a radix sort or Filter-Kruskal on the edges, scratch buffers come from arena A
+int* Kruskal(csrGraph &G, int s, int t, scratchArena &A, kruskalMode mode=KRUSKAL_SORT)
+{
+	arenaMark mark=A.GetMark();
+	int n=G.GetVertexNum();
+	int V=G.GetTotalEdgeNum();
+	edge *E=A.Alloc<edge>(V);
+	int Elen=G.CollectEdges(E);
+	edge *T=A.Alloc<edge>(n);
+	int Tlen=MaxSpanningForest(E, Elen, n, T, A, mode);
+	int *P=TreeParents(T, Tlen, n, s, t, A);
+	A.Release(mark);
+	return P;
+}
+
+// Kruskal's algorithm using a radix sort on the edges
+int* Kruskal(csrGraph &G, int s, int t)
+{
+	scratchArena A;
+	return Kruskal(G, s, t, A);
+}
+
+// Kruskal's algorithm using a radix sort on the edges, on a linked-list graph
+int* Kruskal(undirGraph &G, int s, int t)
+{
+	csrGraph C(G);
+	return Kruskal(C, s, t);
+}
+
+// Structure boruvkaTask: slice of the edges and of the vertices handled by one thread of BoruvkaForest
+struct boruvkaTask {
+	edge *E;		// all edges, the position of an edge breaks ties between equal weights
+	int *live;		// positions of the edges of the slice that may still join two components
+	int livelen;	// live edge number of the slice
+	int lo;			// first vertex of the slice
+	int hi;			// vertex past the last one of the slice
+	int *comp;		// component of each vertex, named by its root vertex
+	int *link;		// component each component is hooked to, then the component it is merged into
+	int *jump;		// second buffer of link for pointer jumping
+	unsigned long long *best;	// key of the heaviest edge leaving each component, 0 if none
+	unsigned char *chosen;		// whether each edge is in the forest
+	bool changed;	// whether the phase changed anything in the slice
+};
+// END of boruvkaTask
+
+// function to return the Boruvka key of the ith edge, larger keys are heavier or earlier edges
+unsigned long long BoruvkaKey(const edge &x, int i)
+{
+	return ((unsigned long long)((unsigned)x.w^0x80000000u)<<32) | (0xFFFFFFFFu-(unsigned)i);
+}
+
+// function to raise *x to v if it is smaller, safe against other threads doing the same
+void AtomicMax(unsigned long long *x, unsigned long long v)
+{
+	unsigned long long cur=__atomic_load_n(x, __ATOMIC_RELAXED);
+	while(cur<v && !__atomic_compare_exchange_n(x, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+// function to drop edges inside a component and offer the others to both their components, run by each thread
+void* BoruvkaPropose(void *arg)
+{
+	boruvkaTask *T=(boruvkaTask*)arg;
+	int len=0;
+	for(int j=0;j<T->livelen;j++) {
+		int i=T->live[j];
+		int x=T->comp[T->E[i].a];
+		int y=T->comp[T->E[i].b];
+		if(x==y) {continue;}
+		T->live[len++]=i;
+		unsigned long long key=BoruvkaKey(T->E[i], i);
+		AtomicMax(&T->best[x], key);
+		AtomicMax(&T->best[y], key);
+	}
+	T->livelen=len;
+	T->changed=(len>0);
+	return NULL;
+}
+
+// function to hook every component to the other end of its heaviest edge, run by each thread
+// Two components picking the same edge hook to each other, the one with the smaller name stays a root.
+void* BoruvkaHook(void *arg)
+{
+	boruvkaTask *T=(boruvkaTask*)arg;
+	for(int c=T->lo;c<T->hi;c++) {
+		if(T->comp[c]!=c) {continue;}
+		unsigned long long key=T->best[c];
+		if(key==0) {
+			T->link[c]=c;
+			continue;
+		}
+		int i=int(0xFFFFFFFFu-(unsigned)(key&0xFFFFFFFFu));
+		int x=T->comp[T->E[i].a];
+		int o=(x==c)?T->comp[T->E[i].b]:x;
+		if(T->best[o]==key && c<o) {
+			T->link[c]=c;
+		} else {
+			T->link[c]=o;
+			T->chosen[i]=1;
+		}
+	}
+	return NULL;
+}
+
+// function to halve the hook chains of the components, run by each thread
+void* BoruvkaJump(void *arg)
+{
+	boruvkaTask *T=(boruvkaTask*)arg;
+	T->changed=false;
+	for(int c=T->lo;c<T->hi;c++) {
+		if(T->comp[c]!=c) {continue;}
+		T->jump[c]=T->link[T->link[c]];
+		if(T->jump[c]!=T->link[c]) {T->changed=true;}
+	}
+	return NULL;
+}
+
+// function to move every vertex to its merged component and clear the heaviest edges, run by each thread
+void* BoruvkaRelabel(void *arg)
+{
+	boruvkaTask *T=(boruvkaTask*)arg;
+	for(int v=T->lo;v<T->hi;v++) {
+		T->comp[v]=T->link[T->comp[v]];
+		T->best[v]=0;
+	}
+	return NULL;
+}
+
+// function to find a maximum spanning forest of E over n vertices with Boruvka's algorithm, its edges are
+// written to T in Kruskal's order; ties go to the earlier edge as in Kruskal's algorithm, so both find the same forest
+// Every round all components pick their heaviest edge and merge along them, so at most log n rounds are needed;
+// the edges and the vertices are split between all processors within each round.
+int BoruvkaForest(edge *E, int Elen, int n, edge *T, scratchArena &A)
+{
+	arenaMark mark=A.GetMark();
+	int k=(Elen<PARALLEL_MIN_SIZE)?1:GetThreadNum();
+	int *live=A.Alloc<int>(Elen);
+	int *comp=A.Alloc<int>(n);
+	int *link=A.Alloc<int>(n);
+	int *jump=A.Alloc<int>(n);
+	unsigned long long *best=A.Alloc<unsigned long long>(n);
+	unsigned char *chosen=A.Alloc<unsigned char>(Elen);
+	for(int i=0;i<Elen;i++) {
+		live[i]=i;
+		chosen[i]=0;
+	}
+	for(int v=0;v<n;v++) {
+		comp[v]=v;
+		link[v]=v;
+		best[v]=0;
+	}
+	boruvkaTask *B=A.Alloc<boruvkaTask>(k);
+	for(int i=0;i<k;i++) {
+		int elo=int((long long)Elen*i/k);
+		B[i].E=E;
+		B[i].live=live+elo;
+		B[i].livelen=int((long long)Elen*(i+1)/k)-elo;
+		B[i].lo=int((long long)n*i/k);
+		B[i].hi=int((long long)n*(i+1)/k);
+		B[i].comp=comp;
+		B[i].link=link;
+		B[i].jump=jump;
+		B[i].best=best;
+		B[i].chosen=chosen;
+	}
+	while(true) {
+		RunParallel(BoruvkaPropose, B, sizeof(boruvkaTask), k);
+		bool more=false;
+		for(int i=0;i<k;i++) {more=more || B[i].changed;}
+		if(!more) {break;}
+		RunParallel(BoruvkaHook, B, sizeof(boruvkaTask), k);
+		do {
+			RunParallel(BoruvkaJump, B, sizeof(boruvkaTask), k);
+			more=false;
+			for(int i=0;i<k;i++) {
+				more=more || B[i].changed;
+				int *swap=B[i].link; B[i].link=B[i].jump; B[i].jump=swap;
+			}
+		} while(more);
+		RunParallel(BoruvkaRelabel, B, sizeof(boruvkaTask), k);
+	}
+	int Tlen=0;
+	for(int i=0;i<Elen;i++) {
+		if(chosen[i]) {T[Tlen++]=E[i];}
+	}
+	RadixSortEdges(T, Tlen, A.Alloc<edge>(Tlen));
+	A.Release(mark);
+	return Tlen;
+}
+
+// Boruvka's algorithm in parallel rounds, scratch buffers come from arena A
+int* Boruvka(csrGraph &G, int s, int t, scratchArena &A)
+{
+	arenaMark mark=A.GetMark();
+	int n=G.GetVertexNum();
+	edge *E=A.Alloc<edge>(G.GetTotalEdgeNum());
+	int Elen=G.CollectEdges(E);
+	edge *T=A.Alloc<edge>(n);
+	int Tlen=BoruvkaForest(E, Elen, n, T, A);
+	int *P=TreeParents(T, Tlen, n, s, t, A);
+	A.Release(mark);
+	return P;
+}
+
+// Boruvka's algorithm in parallel rounds
+int* Boruvka(csrGraph &G, int s, int t)
+{
+	scratchArena A;
+	return Boruvka(G, s, t, A);
+}
+
+// Boruvka's algorithm in parallel rounds, on a linked-list graph
+int* Boruvka(undirGraph &G, int s, int t)
+{
+	csrGraph C(G);
+	return Boruvka(C, s, t);
+}
+
+// function to sort edges by decreasing weight
+void SortEdgesByWeight(edge *E, int len)
+{
+	edge *tmp=new edge[len];
+	RadixSortEdges(E, len, tmp);
+	delete[] tmp;
+}
+
+// Class bottleneckIndex: maximum spanning tree preprocessed for constant-time bandwidth queries
+// The Kruskal reconstruction tree lists the vertices in in-order, and the bandwidth between two
+// vertices is the smallest merge weight between their positions, answered by a sparse table.
+class bottleneckIndex {
+	friend bool SaveSnapshot(const char *path, csrGraph &G, bottleneckIndex *I);
+	private:
+		int size;	// total vertex number
+		int levels;	// number of levels in sparse table
+		int *pos;	// position of each vertex in in-order of reconstruction tree
+		int *table;	// sparse table of range minimum over merge weights, level by level
+		int *par;	// parent of each vertex in the spanning tree, -1 at the root
+		int *depth;	// depth of each vertex in the spanning tree
+		bool owner;	// whether the arrays are freed with the index
+		void Build(int n, edge *E, int Elen);	// build the index from an edge list
+		bottleneckIndex(const bottleneckIndex &other);	// copying is not allowed
+		bottleneckIndex& operator=(const bottleneckIndex &other);	// copying is not allowed
+	public:
+		bottleneckIndex(csrGraph &G);	// parameterized constructor 1
+		bottleneckIndex(undirGraph &G);	// parameterized constructor 2
+		bottleneckIndex(int n, int levels, int *pos, int *table, int *par, int *depth);	// parameterized constructor 3, use arrays kept alive by the caller
+		~bottleneckIndex();	// destructor
+		int GetVertexNum();	// return total vertex number
+		int Bandwidth(int s, int t);	// return max bandwidth between s and t, -1 if not connected
+		int GetPath(int s, int t, int *P);	// write max-bandwidth path from s to t into P, return its vertex number
+		int* Query(int s, int t);	// return parent array of max-bandwidth path from s to t
+		size_t MemoryBytes();	// return bytes of the arrays, whether owned or not
+};
+
+bottleneckIndex::bottleneckIndex(csrGraph &G)	// parameterized constructor 1
+{
+	edge *E=new edge[G.GetTotalEdgeNum()];
+	int Elen=G.CollectEdges(E);
+	Build(G.GetVertexNum(), E, Elen);
+	delete[] E;
+}
+
+bottleneckIndex::bottleneckIndex(undirGraph &G)	// parameterized constructor 2
+{
+	csrGraph C(G);
+	edge *E=new edge[C.GetTotalEdgeNum()];
+	int Elen=C.CollectEdges(E);
+	Build(C.GetVertexNum(), E, Elen);
+	delete[] E;
+}
+
+bottleneckIndex::bottleneckIndex(int n, int levels, int *pos, int *table, int *par, int *depth)	// parameterized constructor 3, use arrays kept alive by the caller
+{
+	owner=false;
+	size=n;
+	this->levels=levels;
+	this->pos=pos;
+	this->table=table;
+	this->par=par;
+	this->depth=depth;
+}
+
+bottleneckIndex::~bottleneckIndex()	// destructor
+{
+	if(!owner) {return;}
+	delete[] pos;
+	delete[] table;
+	delete[] par;
+	delete[] depth;
+}
+
+void bottleneckIndex::Build(int n, edge *E, int Elen)	// build the index from an edge list
+{
+	owner=true;
+	size=n;
+	pos=new int[n];
+	par=new int[n];
+	depth=new int[n];
+	int N=(n>0)?(2*n-1):0;
+	int *left=new int[N];
+	int *right=new int[N];
+	int *kw=new int[N];
+	int *top=new int[n];
+	int *Dad=new int[n];
+	int *rank=new int[n];
+	edge *T=new edge[(n>0)?(n-1):0];
+	int Tlen=0;
+	for(int i=0;i<n;i++) {
+		left[i]=-1;
+		right[i]=-1;
+		top[i]=i;
+		Dad[i]=-1;
+		rank[i]=0;
+	}
+	// Kruskal's algorithm, every union creates a node of the reconstruction tree
+	SortEdgesByWeight(E, Elen);
+	int x=n;
+	for(int i=0;i<Elen && Tlen<n-1;i++) {
+		int r1=Find(E[i].a, n, Dad);
+		int r2=Find(E[i].b, n, Dad);
+		if(r1!=r2) {
+			T[Tlen++]=E[i];
+			left[x]=top[r1];
+			right[x]=top[r2];
+			kw[x]=E[i].w;
+			Union(r1, r2, Dad, rank);
+			top[(Dad[r1]==-1)?r1:r2]=x;
+			x++;
+		}
+	}
+	// join the components with weight -1, so that bandwidth between them is -1
+	int root=-1;
+	for(int i=0;i<n;i++) {
+		if(Dad[i]==-1) {
+			if(root==-1) {
+				root=top[i];
+			} else {
+				left[x]=root;
+				right[x]=top[i];
+				kw[x]=-1;
+				root=x;
+				x++;
+			}
+		}
+	}
+	// in-order traversal, the internal node between two leaves is their lowest common ancestor
+	int wlen=(n>1)?(n-1):1;
+	levels=1;
+	while((1<<levels)<=wlen) {levels++;}
+	table=new int[levels*wlen];
+	int *stack=new int[(N>0)?N:1];
+	int stacklen=0;
+	int leaves=0;
+	int h=root;
+	while(h!=-1 || stacklen) {
+		while(h!=-1) {
+			stack[stacklen++]=h;
+			h=left[h];
+		}
+		h=stack[--stacklen];
+		if(h<n) {
+			pos[h]=leaves++;
+		} else {
+			table[leaves-1]=kw[h];
+		}
+		h=right[h];
+	}
+	for(int j=1;j<levels;j++) {
+		int *prev=table+(j-1)*wlen;
+		int *cur=table+j*wlen;
+		for(int i=0;i+(1<<j)<=wlen;i++) {
+			cur[i]=min(prev[i], prev[i+(1<<(j-1))]);
+		}
+	}
+	// root every tree of the spanning forest for path queries
+	int *offset=new int[n+1];
+	int *adj=new int[2*Tlen];
+	for(int i=0;i<=n;i++) {offset[i]=0;}
+	for(int i=0;i<Tlen;i++) {
+		offset[T[i].a+1]++;
+		offset[T[i].b+1]++;
+	}
+	for(int i=0;i<n;i++) {offset[i+1]+=offset[i];}
+	for(int i=0;i<n;i++) {rank[i]=offset[i];}
+	for(int i=0;i<Tlen;i++) {
+		adj[rank[T[i].a]++]=T[i].b;
+		adj[rank[T[i].b]++]=T[i].a;
+	}
+	for(int i=0;i<n;i++) {par[i]=-2;}
+	for(int i=0;i<n;i++) {
+		if(par[i]==-2) {
+			par[i]=-1;
+			depth[i]=0;
+			stacklen=0;
+			stack[stacklen++]=i;
+			while(stacklen) {
+				int u=stack[--stacklen];
+				for(int k=offset[u];k<offset[u+1];k++) {
+					if(par[adj[k]]==-2) {
+						par[adj[k]]=u;
+						depth[adj[k]]=depth[u]+1;
+						stack[stacklen++]=adj[k];
+					}
+				}
+			}
+		}
+	}
+	delete[] offset;
+	delete[] adj;
+	delete[] stack;
+	delete[] left;
+	delete[] right;
+	delete[] kw;
+	delete[] top;
+	delete[] Dad;
+	delete[] rank;
+	delete[] T;
+}
+
+int bottleneckIndex::GetVertexNum()	// return total vertex number
+{
+	return size;
+}
+
+int bottleneckIndex::Bandwidth(int s, int t)	// return max bandwidth between s and t, -1 if not connected
+{
+	if(s==t) {return INT_MAX;}
+	int i=pos[s];
+	int j=pos[t];
+	if(i>j) {int tmp=i; i=j; j=tmp;}
+	int wlen=(size>1)?(size-1):1;
+	int k=31-__builtin_clz(j-i);
+	int *row=table+k*wlen;
+	return min(row[i], row[j-(1<<k)]);
+}
+
+int bottleneckIndex::GetPath(int s, int t, int *P)	// write max-bandwidth path from s to t into P, return its vertex number
+{
+	if(Bandwidth(s, t)==-1) {return 0;}
+	int a=s;
+	int b=t;
+	while(a!=b) {
+		if(depth[a]>=depth[b]) {a=par[a];}
+		else {b=par[b];}
+		if(a==-1 || b==-1) {return 0;}
+	}
+	int da=depth[s]-depth[a];
+	int db=depth[t]-depth[a];
+	int h=s;
+	for(int i=0;i<=da;i++) {
+		P[i]=h;
+		h=par[h];
+	}
+	h=t;
+	for(int i=da+db;i>da;i--) {
+		P[i]=h;
+		h=par[h];
+	}
+	return da+db+1;
+}
+
+int* bottleneckIndex::Query(int s, int t)	// return parent array of max-bandwidth path from s to t
+{
+	int *Dad=new int[size];
+	int *P=new int[size];
+	for(int i=0;i<size;i++) {Dad[i]=-1;}
+	int len=GetPath(s, t, P);
+	for(int i=1;i<len;i++) {Dad[P[i]]=P[i-1];}
+	delete[] P;
+	return Dad;
+}
+
+size_t bottleneckIndex::MemoryBytes()	// return bytes of the arrays, whether owned or not
+{
+	size_t wlen=(size>1)?(size-1):1;
+	return (3*(size_t)size+levels*wlen)*sizeof(int);
+}
+// END of class bottleneckIndex
+
+// Structure snapshotHeader: first bytes of a graph snapshot file
+// The header is followed by the arrays offset, adj and weight of the csrGraph, then, if levels is not 0,
+// the arrays pos, table, par and depth of the bottleneckIndex; every array is int32 in native byte order
+// and starts on a multiple of 8 bytes. The file can be mapped and used in place.
+struct snapshotHeader {
+	char magic[8];		// "SPGRAPH" and a zero byte
+	uint32_t version;	// SNAPSHOT_VERSION
+	uint32_t order;		// 0x01020304 as written, to reject files from the other byte order
+	int32_t vertices;	// vertex number
+	int32_t slots;		// adjacency slot number, twice the edge number
+	int32_t levels;		// levels of the index sparse table, 0 if no index is stored
+	int32_t reserved;	// zero
+};
+// END of snapshotHeader
+
+// function to return the bytes an array of len int32 takes in a snapshot, padded to a multiple of 8
+size_t SnapshotBytes(long long len)
+{
+	return size_t((len*4+7)&~7LL);
+}
+
+// function to write an array of len int32 to a snapshot with its padding
+void WriteSnapshotArray(ofstream &out, const int *A, long long len)
+{
+	static const char pad[8]={0};
+	out.write((const char*)A, len*4);
+	out.write(pad, SnapshotBytes(len)-len*4);
+}
+
+// function to save graph G and, if I is not NULL, its bottleneck index to a snapshot file at path
+// The file is written next to path and renamed over it, so processes mapping the old file keep a consistent copy.
+bool SaveSnapshot(const char *path, csrGraph &G, bottleneckIndex *I)
+{
+	snapshotHeader h;
+	memset(&h, 0, sizeof(h));
+	strcpy(h.magic, "SPGRAPH");
+	h.version=SNAPSHOT_VERSION;
+	h.order=0x01020304;
+	h.vertices=G.size;
+	h.slots=G.offset[G.size];
+	h.levels=(I!=NULL)?I->levels:0;
+	string tmp=string(path)+".tmp";
+	ofstream out(tmp.c_str(), ios::binary|ios::trunc);
+	if(!out) {return false;}
+	out.write((const char*)&h, sizeof(h));
+	WriteSnapshotArray(out, G.offset, G.size+1);
+	WriteSnapshotArray(out, G.adj, h.slots);
+	WriteSnapshotArray(out, G.weight, h.slots);
+	if(I!=NULL) {
+		int wlen=(I->size>1)?(I->size-1):1;
+		WriteSnapshotArray(out, I->pos, I->size);
+		WriteSnapshotArray(out, I->table, (long long)I->levels*wlen);
+		WriteSnapshotArray(out, I->par, I->size);
+		WriteSnapshotArray(out, I->depth, I->size);
+	}
+	out.close();
+	if(!out || rename(tmp.c_str(), path)!=0) {
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Class graphSnapshot: graph and bottleneck index mapped read-only from a snapshot file
+// Nothing is copied, the graph and index point into the mapping, which is shared with every
+// other process mapping the same file.
+class graphSnapshot {
+	private:
+		void *base;		// start of the mapping, NULL if the file could not be used
+		size_t length;		// bytes of the mapping
+		csrGraph *graph;	// graph in the mapping
+		bottleneckIndex *index;	// index in the mapping, NULL if none is stored
+		graphSnapshot(const graphSnapshot &other);	// copying is not allowed
+		graphSnapshot& operator=(const graphSnapshot &other);	// copying is not allowed
+	public:
+		graphSnapshot(const char *path);	// parameterized constructor, map the file at path
+		~graphSnapshot();	// destructor
+		bool IsValid();		// return whether the file was mapped and checked
+		csrGraph* GetGraph();	// return the graph, NULL if not valid
+		bottleneckIndex* GetIndex();	// return the index, NULL if none is stored
+};
+
+graphSnapshot::graphSnapshot(const char *path)	// parameterized constructor, map the file at path
+{
+	base=NULL;
+	length=0;
+	graph=NULL;
+	index=NULL;
+	int fd=open(path, O_RDONLY);
+	if(fd<0) {return;}
+	struct stat st;
+	if(fstat(fd, &st)!=0 || st.st_size<(off_t)sizeof(snapshotHeader)) {
+		close(fd);
+		return;
+	}
+	void *p=mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p==MAP_FAILED) {return;}
+	snapshotHeader *h=(snapshotHeader*)p;
+	long long n=h->vertices;
+	long long wlen=(n>1)?(n-1):1;
+	size_t need=0;
+	bool ok=(memcmp(h->magic, "SPGRAPH", 8)==0 && h->version==SNAPSHOT_VERSION && h->order==0x01020304
+		&& n>=0 && h->slots>=0 && h->levels>=0 && h->levels<=32);
+	if(ok) {
+		need=sizeof(snapshotHeader)+SnapshotBytes(n+1)+2*SnapshotBytes(h->slots);
+		if(h->levels>0) {need+=3*SnapshotBytes(n)+SnapshotBytes(h->levels*wlen);}
+		ok=((size_t)st.st_size==need);
+	}
+	// every array is checked so a damaged file cannot send the queries outside the arrays
+	char *at=(char*)p+sizeof(snapshotHeader);
+	int *offset=(int*)at; at+=SnapshotBytes(n+1);
+	int *adj=(int*)at; at+=SnapshotBytes(h->slots);
+	int *weight=(int*)at; at+=SnapshotBytes(h->slots);
+	int *pos=NULL, *table=NULL, *par=NULL, *depth=NULL;
+	if(ok && h->levels>0) {
+		pos=(int*)at; at+=SnapshotBytes(n);
+		table=(int*)at; at+=SnapshotBytes(h->levels*wlen);
+		par=(int*)at; at+=SnapshotBytes(n);
+		depth=(int*)at;
+	}
+	ok=ok && offset[0]==0 && offset[n]==h->slots;
+	for(long long i=0;ok && i<n;i++) {ok=(offset[i]<=offset[i+1]);}
+	for(long long i=0;ok && i<h->slots;i++) {ok=(adj[i]>=0 && adj[i]<n && weight[i]>=1);}
+	if(ok && h->levels>0) {
+		// levels must be what bottleneckIndex::Build gives for n, pos a permutation,
+		// and par and depth a forest whose depth drops by one towards each root
+		int levels=1;
+		while((1LL<<levels)<=wlen) {levels++;}
+		ok=(h->levels==levels);
+		vector<bool> seen(ok?n:0, false);
+		for(long long i=0;ok && i<n;i++) {
+			ok=(pos[i]>=0 && pos[i]<n && !seen[pos[i]]);
+			if(ok) {seen[pos[i]]=true;}
+		}
+		for(long long i=0;ok && i<n;i++) {
+			ok=(depth[i]>=0 && depth[i]<n && par[i]>=-1 && par[i]<n);
+			if(ok) {ok=(par[i]==-1)?(depth[i]==0):(depth[i]>0 && depth[par[i]]==depth[i]-1);}
+		}
+	}
+	if(!ok) {
+		munmap(p, st.st_size);
+		return;
+	}
+	base=p;
+	length=st.st_size;
+	graph=new csrGraph(int(n), offset, adj, weight);
+	if(h->levels>0) {index=new bottleneckIndex(int(n), h->levels, pos, table, par, depth);}
+}
+
+graphSnapshot::~graphSnapshot()	// destructor
+{
+	delete index;
+	delete graph;
+	if(base!=NULL) {munmap(base, length);}
+}
+
+bool graphSnapshot::IsValid()	// return whether the file was mapped and checked
+{
+	return base!=NULL;
+}
+
+csrGraph* graphSnapshot::GetGraph()	// return the graph, NULL if not valid
+{
+	return graph;
+}
+
+bottleneckIndex* graphSnapshot::GetIndex()	// return the index, NULL if none is stored
+{
+	return index;
+}
+// END of class graphSnapshot
+
+// function to return wall-clock time in microseconds from an arbitrary start
+double WallMicros()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e6+ts.tv_nsec/1e3;
+}
+
+// Class phaseTrace: nested timed phases of an algorithm, exported as Chrome trace-event JSON
+// A phase opened after another and closed before it is shown inside it. Phases must come from one thread.
+class phaseTrace {
+	private:
+		struct phase {
+			const char *name;	// phase name, not copied
+			double begin;	// start in microseconds since the trace was created
+			double end;	// end in microseconds since the trace was created, -1 while open
+			int level;	// recursion level, -1 if none
+			int n;		// vertex number the phase works on, -1 if none
+			int m;		// edge number the phase works on, -1 if none
+		};
+		vector<phase> phases;	// phases in the order they were opened
+		double origin;	// time the trace was created
+		phaseTrace(const phaseTrace &other);	// copying is not allowed
+		phaseTrace& operator=(const phaseTrace &other);	// copying is not allowed
+	public:
+		phaseTrace();		// default constructor
+		int Begin(const char *name, int level, int n, int m);	// open a phase, return its id
+		void End(int id);	// close phase id
+		int GetLength();	// return number of phases recorded
+		bool Save(const char *path);	// write the closed phases to a file, false if it cannot be written
+};
+
+phaseTrace::phaseTrace()	// default constructor
+{
+	origin=WallMicros();
+}
+
+int phaseTrace::Begin(const char *name, int level, int n, int m)	// open a phase, return its id
+{
+	phase x;
+	x.name=name;
+	x.level=level;
+	x.n=n;
+	x.m=m;
+	x.end=-1;
+	x.begin=WallMicros()-origin;
+	phases.push_back(x);
+	return int(phases.size())-1;
+}
+
+void phaseTrace::End(int id)	// close phase id
+{
+	phases[id].end=WallMicros()-origin;
+}
+
+int phaseTrace::GetLength()	// return number of phases recorded
+{
+	return int(phases.size());
+}
+
+bool phaseTrace::Save(const char *path)	// write the closed phases to a file, false if it cannot be written
+{
+	ofstream out(path);
+	if(!out) {return false;}
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["<<fixed<<setprecision(3);
+	bool first=true;
+	for(size_t i=0;i<phases.size();i++) {
+		phase &x=phases[i];
+		if(x.end<0) {continue;}
+		out << (first?"\n":",\n")<<"{\"name\": \""<<x.name<<"\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": "<<x.begin
+			<<", \"dur\": "<<x.end-x.begin<<", \"args\": {";
+		bool comma=false;
+		if(x.level>=0) {out << "\"level\": "<<x.level; comma=true;}
+		if(x.n>=0) {out << (comma?", ":"")<<"\"n\": "<<x.n; comma=true;}
+		if(x.m>=0) {out << (comma?", ":"")<<"\"m\": "<<x.m;}
+		out << "}}";
+		first=false;
+	}
+	out << "\n]}"<<endl;
+	return bool(out);
+}
+// END of class phaseTrace
+
+// function to open a phase in trace P, return its id or -1 if P is NULL
+int TraceBegin(phaseTrace *P, const char *name, int level, int n, int m)
+{
+	return (P!=NULL)?P->Begin(name, level, n, m):-1;
+}
+
+// function to close phase id opened by TraceBegin
+void TraceEnd(phaseTrace *P, int id)
+{
+	if(P!=NULL) {P->End(id);}
+}
+
+// function to sort a few edges by decreasing weight
+void InsertionSortEdges(edge *E, int n)
+{
+	for(int i=1;i<n;i++) {
+		edge tmp=E[i];
+		int j=i;
+		while(j>0 && E[j-1].w<tmp.w) {
+			E[j]=E[j-1];
+			j--;
+		}
+		E[j]=tmp;
+	}
+}
+
+// function to split edges around weight p in place: E[0..lt) heavier, E[lt..gt) equal, E[gt..n) lighter
+void PartitionEdges(edge *E, int n, int p, int &lt, int &gt)
+{
+	int i=0;
+	lt=0;
+	gt=n;
+	opCount::Add(OP_PARTITION);
+	while(i<gt) {
+		if(E[i].w>p) {
+			edge tmp=E[i]; E[i]=E[lt]; E[lt]=tmp;
+			lt++;
+			i++;
+		} else if(E[i].w<p) {
+			gt--;
+			edge tmp=E[i]; E[i]=E[gt]; E[gt]=tmp;
+		} else {
+			i++;
+		}
+	}
+}
+
+// function to pick a pivot weight by median of medians of groups of five, reorders E
+int MedianOfMedians(edge *E, int n)
+{
+	if(n<=5) {
+		InsertionSortEdges(E, n);
+		return E[n/2].w;
+	}
+	int g=0;
+	for(int i=0;i<n;i+=5) {
+		int len=(n-i<5)?(n-i):5;
+		InsertionSortEdges(E+i, len);
+		edge tmp=E[g]; E[g]=E[i+len/2]; E[i+len/2]=tmp;
+		g++;
+	}
+	SelectEdge(E, g, g/2);
+	return E[g/2].w;
+}
+
+// function to select in place the edge with kth largest weight (k from 0), heavier edges are moved before it
+// Quickselect with median-of-three pivots, switching to median of medians for good as soon as a partition
+// keeps more than 3/4 of the range or two partitions do not halve it, so the range shrinks geometrically.
+void SelectEdge(edge *E, int n, int k)
+{
+	int lo=0;
+	int hi=n;
+	bool fallback=false;	// whether pivots come from median of medians
+	int window=n;		// range size two partitions ago
+	int rounds=0;
+	opCount::Add(OP_SELECT);
+	while(hi-lo>16) {
+		int len=hi-lo;
+		int p;
+		if(!fallback) {
+			int a=E[lo].w;
+			int b=E[lo+len/2].w;
+			int c=E[hi-1].w;
+			p=max(min(a,b), min(max(a,b),c));
+		} else {
+			p=MedianOfMedians(E+lo, len);
+		}
+		int lt, gt;
+		PartitionEdges(E+lo, len, p, lt, gt);
+		lt+=lo;
+		gt+=lo;
+		if(k<lt) {hi=lt;}
+		else if(k>=gt) {lo=gt;}
+		else {return;}
+		if(4LL*(hi-lo)>3LL*len) {fallback=true;}
+		if(++rounds%2==0) {
+			if(2LL*(hi-lo)>window) {fallback=true;}
+			window=hi-lo;
+		}
+	}
+	InsertionSortEdges(E+lo, hi-lo);
+}
+
+// function to build path in a undirected graph for the linear-time algorithm
+// walks from source over edges not lighter than band until target is reached
+int* BuildPath(csrGraph &G, int source, int target, int band, scratchArena &A)
+{
+	int n=G.GetVertexNum();
+	int *Dad=new int[n];
 	for(int i=0;i<n;i++) {Dad[i]=-1;}
-	int stack[n];
+	if(band==-1) {return Dad;}
+	arenaMark mark=A.GetMark();
+	bool *seen=A.Alloc<bool>(n);
+	for(int i=0;i<n;i++) {seen[i]=false;}
+	int *stack=A.Alloc<int>(n);
 	int stacklen=0;
 	stack[stacklen++]=source;
-	undirGraph Gdummy=G;
-	while(stacklen) {
+	seen[source]=true;
+	while(stacklen && !seen[target]) {
 		int tt=stack[--stacklen];
-		for(node* ptr=Gdummy.GetEdges(tt);ptr!=NULL;ptr=ptr->GetNextNode()) {
-			Dad[ptr->GetVertex()]=tt;
-			stack[stacklen++]=ptr->GetVertex();
+		for(int k=G.GetBegin(tt);k<G.GetEnd(tt);k++) {
+			int v=G.GetVertex(k);
+			if(!seen[v] && G.GetWeight(k)>=band) {
+				seen[v]=true;
+				Dad[v]=tt;
+				stack[stacklen++]=v;
+			}
 		}
-		Gdummy.CleanIthEdges(tt);
 	}
+	A.Release(mark);
 	return Dad;
 }
 
-// Linear-time algorithm to find max-bandwith path based on median of median
-int* LinearAlgTrue(undirGraph &G, int s, int t) {
-	const rlim_t kStackSize = 512 * 1024 * 1024;   // min stack size = 512 MB
-   	struct rlimit rl;
-   	int result;
-   	result = getrlimit(RLIMIT_STACK, &rl);
-   	if (result == 0)
-   	{
-   	    if (rl.rlim_cur < kStackSize)
-   	    {
-   	        rl.rlim_cur = kStackSize;
-   	        result = setrlimit(RLIMIT_STACK, &rl);
-   	        if (result != 0)
-   	        {
-   	            fprintf(stderr, "setrlimit returned result = %d\n", result);
-   	        }
-   	    }
-   	}
-	int n=G.GetVertexNum();
-	int V=G.GetTotalEdgeNum();
-	edge E[V];
-	int Elen=0;
-	node* ptr;
-	for(int i=0;i<n;i++) {
-		ptr=G.GetEdges(i);
-		for(node* p=ptr;p!=NULL;p=p->GetNextNode()) {
-			if(p->GetVertex()>i) {
-				E[Elen].a=i;
-				E[Elen].b=p->GetVertex();
-				E[Elen].w=p->GetWeight();
-				Elen++;
+// function to find the max bandwidth between s and t by median split of the edges, -1 if not connected
+// E is an edge list over vertices 0..n-1 and is overwritten; every round keeps at most half of the edges
+// and at most two vertices per remaining edge, so the total work is linear in the number of edges.
+// Each round and its phases are recorded in P unless it is NULL.
+int LinearBandwidth(edge *E, int m, int n, int s, int t, scratchArena &A, phaseTrace *P=NULL)
+{
+	arenaMark mark=A.GetMark();
+	for(int level=0;;level++) {
+		A.Release(mark);
+		if(s==t) {return INT_MAX;}
+		if(m==0) {return -1;}
+		int round=TraceBegin(P, "round", level, n, m);
+		// relabel the vertices still carrying edges, so the next steps are linear in m
+		if(n>2*m+2) {
+			int phase=TraceBegin(P, "relabel", level, n, m);
+			int *Map=A.Alloc<int>(n);
+			for(int i=0;i<n;i++) {Map[i]=-1;}
+			int nNew=0;
+			Map[s]=nNew++;
+			Map[t]=nNew++;
+			for(int i=0;i<m;i++) {
+				if(Map[E[i].a]==-1) {Map[E[i].a]=nNew++;}
+				if(Map[E[i].b]==-1) {Map[E[i].b]=nNew++;}
+				E[i].a=Map[E[i].a];
+				E[i].b=Map[E[i].b];
 			}
+			s=Map[s];
+			t=Map[t];
+			n=nNew;
+			TraceEnd(P, phase);
 		}
-	}
-	int m = Median(E, Elen, Elen/2);
-	edge Large[V], Small[V];
-	int Llen=0; int Slen=0;
-	int flag=0;
-	for(int i=0;i<Elen;i++) {
-		if(E[i].w>m) {
-			Large[Llen].a=E[i].a;
-			Large[Llen].b=E[i].b;
-			Large[Llen].w=E[i].w;
-			Llen++;
+		int *Dad=A.Alloc<int>(n);
+		int *rank=A.Alloc<int>(n);
+		for(int i=0;i<n;i++) {
+			Dad[i]=-1;
+			rank[i]=0;
+		}
+		if(m<=LINEAR_BASE_SIZE) {
+			// few edges left, Kruskal's algorithm on them
+			int phase=TraceBegin(P, "base kruskal", level, n, m);
+			for(int i=1;i<m;i++) {
+				for(int j=i;j>0 && E[j].w>E[j-1].w;j--) {
+					edge tmp=E[j]; E[j]=E[j-1]; E[j-1]=tmp;
+				}
+			}
+			int band=-1;
+			for(int i=0;i<m;i++) {
+				int r1=Find(E[i].a, n, Dad);
+				int r2=Find(E[i].b, n, Dad);
+				if(r1!=r2) {Union(r1, r2, Dad, rank);}
+				if(Find(s, n, Dad)==Find(t, n, Dad)) {band=E[i].w; break;}
+			}
+			TraceEnd(P, phase);
+			TraceEnd(P, round);
+			A.Release(mark);
+			return band;
+		}
+		// move the heavier half of the edges to the front
+		int Llen=(m+1)/2;
+		int phase=TraceBegin(P, "median split", level, n, m);
+		SelectEdge(E, m, Llen-1);
+		TraceEnd(P, phase);
+		// label the components of the heavier half
+		phase=TraceBegin(P, "label components", level, n, Llen);
+		for(int i=0;i<Llen;i++) {
+			int r1=Find(E[i].a, n, Dad);
+			int r2=Find(E[i].b, n, Dad);
+			if(r1!=r2) {Union(r1, r2, Dad, rank);}
+		}
+		TraceEnd(P, phase);
+		if(Find(s, n, Dad)==Find(t, n, Dad)) {
+			// s and t are joined by heavy edges only
+			m=Llen;
 		} else {
-			Small[Slen].a=E[i].a;
-			Small[Slen].b=E[i].b;
-			Small[Slen].w=E[i].w;
-			Slen++;
+			// contract every component of the heavier half into one vertex
+			phase=TraceBegin(P, "contract", level, n, m-Llen);
+			int *Com=rank;
+			for(int i=0;i<n;i++) {Com[i]=-1;}
+			int nNew=0;
+			for(int i=0;i<n;i++) {
+				int r=Find(i, n, Dad);
+				if(Com[r]==-1) {Com[r]=nNew++;}
+			}
+			int mNew=0;
+			for(int i=Llen;i<m;i++) {
+				int a=Com[Find(E[i].a, n, Dad)];
+				int b=Com[Find(E[i].b, n, Dad)];
+				if(a!=b) {
+					E[mNew].a=a;
+					E[mNew].b=b;
+					E[mNew].w=E[i].w;
+					mNew++;
+				}
+			}
+			s=Com[Find(s, n, Dad)];
+			t=Com[Find(t, n, Dad)];
+			n=nNew;
+			m=mNew;
+			TraceEnd(P, phase);
 		}
+		TraceEnd(P, round);
 	}
-	undirGraph Glarge(n, Large, Llen);
-	undirGraph Gsmall(n, Small, Slen);
-	int Com[n];
-	for(int i=0;i<n;i++) {Com[i]=-1;}
-	int count=0;
-	undirGraph Gdummy=Glarge;
-	int stack[n];
-	int stacklen=0;
-	for(int i=0;i<n;i++) {
-		if(Com[i]==-1) {
-			Com[i]=count; count++;
-			stack[stacklen++]=i;
-			while(stacklen) {
-				int h=stack[--stacklen];
-				for(int j=0;j<n;j++) {
-					if(Gdummy.SearchEdge(h, j) && Com[j]==-1) {
-						Com[j]=Com[h];	Gdummy.DeleteEdge(h, j); stack[stacklen++]=j;
-					}
-				}
+}
+
+// Linear-time algorithm to find max-bandwith path based on median of median, scratch buffers come from arena A
+// the query and its phases are recorded in P unless it is NULL
+int* LinearAlgTrue(csrGraph &G, int s, int t, scratchArena &A, phaseTrace *P=NULL)
+{
+	int n=G.GetVertexNum();
+	int m=G.GetTotalEdgeNum();
+	int query=TraceBegin(P, "LinearAlgTrue", -1, n, m);
+	arenaMark mark=A.GetMark();
+	int phase=TraceBegin(P, "collect edges", -1, n, m);
+	edge *E=A.Alloc<edge>(m);
+	int Elen=G.CollectEdges(E);
+	TraceEnd(P, phase);
+	phase=TraceBegin(P, "bandwidth", -1, n, Elen);
+	int band=LinearBandwidth(E, Elen, n, s, t, A, P);
+	TraceEnd(P, phase);
+	A.Release(mark);
+	phase=TraceBegin(P, "build path", -1, n, m);
+	int *Dad=BuildPath(G, s, t, band, A);
+	TraceEnd(P, phase);
+	TraceEnd(P, query);
+	return Dad;
+}
+
+// Linear-time algorithm to find max-bandwith path based on median of median
+int* LinearAlgTrue(csrGraph &G, int s, int t)
+{
+	scratchArena A;
+	return LinearAlgTrue(G, s, t, A);
+}
+
+// Linear-time algorithm to find max-bandwith path based on median of median, on a linked-list graph
+int* LinearAlgTrue(undirGraph &G, int s, int t)
+{
+	csrGraph C(G);
+	return LinearAlgTrue(C, s, t);
+}
+
+// Enumeration queryAlg: algorithm answering a query of the query service
+enum queryAlg {
+	QUERY_DIJKSTRA=0,	// Dijkstra's algorithm without heap
+	QUERY_HEAP=1,		// Dijkstra's algorithm with max-heap
+	QUERY_RADIX=2,		// Dijkstra's algorithm with radix heap
+	QUERY_BIDIRECTIONAL=3,	// bidirectional Dijkstra's algorithm
+	QUERY_INDEX=4		// bottleneck index, falls back to max-heap search without one
+};
+// END of queryAlg
+
+// Structure query: one s-t bandwidth query and its answer
+struct query {
+	int s;		// source vertex
+	int t;		// target vertex
+	queryAlg alg;	// algorithm answering the query
+	int band;	// max bandwidth from s to t, INT_MAX if s equals t, -1 if not connected
+};
+// END of query
+
+// Class queryService: pool of worker threads answering bandwidth queries on a shared read-only graph
+// Each worker owns its workspaces, so queries share nothing but the graph and the index; a batch is
+// handed out to the workers in chunks of QUERY_CHUNK queries.
+class queryService {
+	private:
+		csrGraph *graph;	// graph the queries run on, not owned
+		bottleneckIndex *index;	// index for QUERY_INDEX, not owned, NULL if none
+		int threads;		// number of worker threads
+		pthread_t *th;		// worker threads
+		int started;		// number of worker threads running
+		pthread_mutex_t lock;	// guards the fields below
+		pthread_cond_t ready;	// signalled when a batch is posted or the service stops
+		pthread_cond_t done;	// signalled when the last worker finishes a batch
+		pthread_mutex_t batch;	// lets one batch run at a time
+		query *Q;		// queries of the current batch
+		int qlen;		// length of Q
+		int next;		// first query not yet handed out
+		int active;		// workers still busy with the current batch
+		long generation;	// number of batches posted
+		bool stopping;		// whether the workers should exit
+		static void* Worker(void *arg);	// main loop of each worker thread
+		void Answer(query &q, queryWorkspace &W, queryWorkspace &B);	// answer one query with the given workspaces
+		queryService(const queryService &other);	// copying is not allowed
+		queryService& operator=(const queryService &other);	// copying is not allowed
+	public:
+		queryService(csrGraph &G, bottleneckIndex *I=NULL, int k=0);	// parameterized constructor, k<=0 uses all processors
+		~queryService();	// destructor
+		int GetThreadNum();	// return number of worker threads
+		void Run(query *Q, int len);	// answer a batch of queries, returns when all are answered
+		int Bandwidth(int s, int t, queryAlg alg);	// answer a single query
+};
+
+queryService::queryService(csrGraph &G, bottleneckIndex *I, int k)	// parameterized constructor, k<=0 uses all processors
+{
+	graph=&G;
+	index=I;
+	threads=(k>0)?k:(::GetThreadNum());
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&ready, NULL);
+	pthread_cond_init(&done, NULL);
+	pthread_mutex_init(&batch, NULL);
+	Q=NULL;
+	qlen=0;
+	next=0;
+	active=0;
+	generation=0;
+	stopping=false;
+	th=new pthread_t[threads];
+	started=0;
+	while(started<threads && pthread_create(&th[started], NULL, Worker, this)==0) {started++;}
+}
+
+queryService::~queryService()	// destructor
+{
+	pthread_mutex_lock(&lock);
+	stopping=true;
+	pthread_cond_broadcast(&ready);
+	pthread_mutex_unlock(&lock);
+	for(int i=0;i<started;i++) {pthread_join(th[i], NULL);}
+	delete[] th;
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&ready);
+	pthread_cond_destroy(&done);
+	pthread_mutex_destroy(&batch);
+}
+
+void* queryService::Worker(void *arg)	// main loop of each worker thread
+{
+	queryService *S=(queryService*)arg;
+	int n=S->graph->GetVertexNum();
+	queryWorkspace W(n);
+	queryWorkspace B(n);
+	long seen=0;
+	pthread_mutex_lock(&S->lock);
+	while(true) {
+		while(!S->stopping && S->generation==seen) {pthread_cond_wait(&S->ready, &S->lock);}
+		if(S->stopping) {break;}
+		seen=S->generation;
+		pthread_mutex_unlock(&S->lock);
+		int i;
+		while((i=__atomic_fetch_add(&S->next, QUERY_CHUNK, __ATOMIC_RELAXED))<S->qlen) {
+			int end=min(i+QUERY_CHUNK, S->qlen);
+			for(;i<end;i++) {S->Answer(S->Q[i], W, B);}
+		}
+		pthread_mutex_lock(&S->lock);
+		if(--S->active==0) {pthread_cond_signal(&S->done);}
+	}
+	pthread_mutex_unlock(&S->lock);
+	return NULL;
+}
+
+void queryService::Answer(query &q, queryWorkspace &W, queryWorkspace &B)	// answer one query with the given workspaces
+{
+	int n=graph->GetVertexNum();
+	int *Dad=NULL;
+	if(q.s<0 || q.s>=n || q.t<0 || q.t>=n) {
+		q.band=-1;
+		return;
+	}
+	if(q.s==q.t) {
+		q.band=INT_MAX;
+		return;
+	}
+	switch(q.alg) {
+		case QUERY_DIJKSTRA: Dad=Dijkstra(*graph, q.s, q.t, W); break;
+		case QUERY_RADIX: Dad=RadixDijkstra(*graph, q.s, q.t, W); break;
+		case QUERY_BIDIRECTIONAL: Dad=BidirectionalDijkstra(*graph, q.s, q.t, W, B); break;
+		case QUERY_INDEX:
+			if(index!=NULL) {
+				q.band=index->Bandwidth(q.s, q.t);
+				return;
 			}
+			Dad=ModifiedDijkstra(*graph, q.s, q.t, W);
+			break;
+		default: Dad=ModifiedDijkstra(*graph, q.s, q.t, W); break;
+	}
+	q.band=(Dad[q.t]!=-1)?W.GetCap(q.t):-1;
+}
+
+int queryService::GetThreadNum()	// return number of worker threads
+{
+	return started;
+}
+
+void queryService::Run(query *Q, int len)	// answer a batch of queries, returns when all are answered
+{
+	if(started==0) {
+		queryWorkspace W(graph->GetVertexNum());
+		queryWorkspace B(graph->GetVertexNum());
+		for(int i=0;i<len;i++) {Answer(Q[i], W, B);}
+		return;
+	}
+	pthread_mutex_lock(&batch);
+	pthread_mutex_lock(&lock);
+	this->Q=Q;
+	qlen=len;
+	next=0;
+	active=started;
+	generation++;
+	pthread_cond_broadcast(&ready);
+	while(active>0) {pthread_cond_wait(&done, &lock);}
+	pthread_mutex_unlock(&lock);
+	pthread_mutex_unlock(&batch);
+}
+
+int queryService::Bandwidth(int s, int t, queryAlg alg)	// answer a single query
+{
+	query q;
+	q.s=s;
+	q.t=t;
+	q.alg=alg;
+	q.band=-1;
+	Run(&q, 1);
+	return q.band;
+}
+// END of class queryService
+
+// function to return the bandwidth of the path from s to t given by parent array Dad,
+// INT_MAX if s equals t, -1 if there is no path, -2 if Dad does not hold a path of G
+int PathBandwidth(csrGraph &G, int *Dad, int s, int t)
+{
+	if(s==t) {return INT_MAX;}
+	if(Dad[t]==-1) {return -1;}
+	int band=INT_MAX;
+	int v=t;
+	for(int steps=0;v!=s;steps++) {
+		int u=Dad[v];
+		if(steps>=G.GetVertexNum() || u<0) {return -2;}
+		int w=-1;
+		for(int k=G.GetBegin(v);k<G.GetEnd(v);k++) {
+			if(G.GetVertex(k)==u) {w=max(w, G.GetWeight(k));}
 		}
+		if(w<0) {return -2;}
+		band=min(band, w);
+		v=u;
 	}
-	if(Com[s]==Com[t]) {
-		return LinearAlgTrue(Glarge, s, t);
-	} else {
-		int nNew=Com[0];
-		for(int i=0;i<n;i++) { if(Com[i]>nNew) {nNew=Com[i];} }
-		nNew++;
-		undirGraph Gnew(nNew);
-		int k; edge P;
-		edge test[nNew*(nNew-1)/2];
-		edge NewE[nNew][nNew];
-		for(int i=0;i<nNew;i++) {
-			for(int j=0;j<nNew;j++) {
-				NewE[i][j].a=-1;
-				NewE[i][j].b=-1;
-				NewE[i][j].w=-1;
+	return band;
+}
+
+// Class perfCounters: hardware performance counters of the calling thread, read through perf_event_open
+// Each counter is opened on its own, so a counter the machine lacks leaves the others working.
+// Counting covers user space only, between Start and Stop, and adds up over several intervals.
+// Threads started while counting, such as those of the parallel sorts, are counted too.
+class perfCounters {
+	private:
+		int fd[PERF_COUNTER_NUM];	// file descriptor of each counter, -1 if it could not be opened
+		long long total[PERF_COUNTER_NUM];	// events counted so far
+		perfCounters(const perfCounters &other);	// copying is not allowed
+		perfCounters& operator=(const perfCounters &other);	// copying is not allowed
+	public:
+		perfCounters();		// default constructor, open the counters
+		~perfCounters();	// destructor
+		static const char* GetName(int i);	// return name of the ith counter
+		bool IsAvailable();	// return whether any counter could be opened
+		void Clear();		// set all counts to zero
+		void Start();		// start counting
+		void Stop();		// stop counting and add the events to the counts
+		long long GetCount(int i);	// return events of the ith counter, -1 if not available
+};
+
+perfCounters::perfCounters()	// default constructor, open the counters
+{
+	const unsigned long long cache=PERF_COUNT_HW_CACHE_OP_READ<<8 | PERF_COUNT_HW_CACHE_RESULT_MISS<<16;
+	const unsigned types[PERF_COUNTER_NUM]={PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+		PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+	const unsigned long long configs[PERF_COUNTER_NUM]={PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_L1D|cache, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+		PERF_COUNT_HW_CACHE_DTLB|cache};
+	for(int i=0;i<PERF_COUNTER_NUM;i++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size=sizeof(attr);
+		attr.type=types[i];
+		attr.config=configs[i];
+		attr.disabled=1;
+		attr.exclude_kernel=1;
+		attr.exclude_hv=1;
+		attr.inherit=1;
+		fd[i]=int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+		total[i]=0;
+	}
+}
+
+perfCounters::~perfCounters()	// destructor
+{
+	for(int i=0;i<PERF_COUNTER_NUM;i++) {
+		if(fd[i]>=0) {close(fd[i]);}
+	}
+}
+
+const char* perfCounters::GetName(int i)	// return name of the ith counter
+{
+	const char *names[PERF_COUNTER_NUM]={"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"};
+	return names[i];
+}
+
+bool perfCounters::IsAvailable()	// return whether any counter could be opened
+{
+	for(int i=0;i<PERF_COUNTER_NUM;i++) {
+		if(fd[i]>=0) {return true;}
+	}
+	return false;
+}
+
+void perfCounters::Clear()	// set all counts to zero
+{
+	for(int i=0;i<PERF_COUNTER_NUM;i++) {total[i]=0;}
+}
+
+void perfCounters::Start()	// start counting
+{
+	for(int i=0;i<PERF_COUNTER_NUM;i++) {
+		if(fd[i]>=0) {
+			ioctl(fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+void perfCounters::Stop()	// stop counting and add the events to the counts
+{
+	for(int i=0;i<PERF_COUNTER_NUM;i++) {
+		if(fd[i]>=0) {ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);}
+	}
+	for(int i=0;i<PERF_COUNTER_NUM;i++) {
+		long long v;
+		if(fd[i]>=0 && read(fd[i], &v, sizeof(v))==(ssize_t)sizeof(v)) {total[i]+=v;}
+	}
+}
+
+long long perfCounters::GetCount(int i)	// return events of the ith counter, -1 if not available
+{
+	return (fd[i]>=0)?total[i]:-1;
+}
+// END of class perfCounters
+
+// Structure benchState: scratch shared by the runs of all algorithms on one graph
+struct benchState {
+	queryWorkspace *W;	// workspace of the searches
+	queryWorkspace *B;	// backward workspace of the bidirectional search
+	scratchArena *A;	// scratch memory of the spanning-tree and linear-time algorithms
+	bottleneckIndex *I;	// index of the graph, NULL until an algorithm needs it
+	phaseTrace *P;		// trace of the linear-time algorithm, NULL if not traced
+	int band;		// answer of an algorithm that gives no path
+};
+// END of benchState
+
+int* BenchDijkstra(csrGraph &G, int s, int t, benchState &S) {return Dijkstra(G, s, t, *S.W);}
+int* BenchHeap(csrGraph &G, int s, int t, benchState &S) {return ModifiedDijkstra(G, s, t, *S.W);}
+int* BenchRadix(csrGraph &G, int s, int t, benchState &S) {return RadixDijkstra(G, s, t, *S.W);}
+int* BenchBidirectional(csrGraph &G, int s, int t, benchState &S) {return BidirectionalDijkstra(G, s, t, *S.W, *S.B);}
+int* BenchKruskal(csrGraph &G, int s, int t, benchState &S) {return Kruskal(G, s, t, *S.A);}
+int* BenchFilterKruskal(csrGraph &G, int s, int t, benchState &S) {return Kruskal(G, s, t, *S.A, KRUSKAL_FILTER);}
+int* BenchBoruvka(csrGraph &G, int s, int t, benchState &S) {return Boruvka(G, s, t, *S.A);}
+int* BenchLinear(csrGraph &G, int s, int t, benchState &S) {return LinearAlgTrue(G, s, t, *S.A, S.P);}
+int* BenchIndex(csrGraph &G, int s, int t, benchState &S) {S.band=S.I->Bandwidth(s, t); return NULL;}
+
+// Structure benchAlgorithm: entry of the benchmark registry
+struct benchAlgorithm {
+	const char *name;	// name in options and output
+	int* (*run)(csrGraph &G, int s, int t, benchState &S);	// answer one query, return its parent array or NULL with the bandwidth in S.band
+	bool owned;		// whether the parent array is new and freed by the benchmark
+	bool index;		// whether the algorithm needs the bottleneck index
+	int workspaces;		// number of query workspaces the algorithm uses
+	int maxsize;		// largest vertex number the algorithm is run on, 0 if no limit
+};
+// END of benchAlgorithm
+
+// registry of the algorithms the benchmark runs, the first one run on a graph gives the reference answers
+const benchAlgorithm BENCH_ALGORITHMS[]={
+	{"index", BenchIndex, false, true, 0, 0},
+	{"heap", BenchHeap, false, false, 1, 0},
+	{"radix", BenchRadix, false, false, 1, 0},
+	{"bidirectional", BenchBidirectional, false, false, 2, 0},
+	{"dijkstra", BenchDijkstra, false, false, 1, 20000},
+	{"kruskal", BenchKruskal, true, false, 0, 0},
+	{"filter-kruskal", BenchFilterKruskal, true, false, 0, 0},
+	{"boruvka", BenchBoruvka, true, false, 0, 0},
+	{"linear", BenchLinear, true, false, 0, 0}
+};
+const int BENCH_ALGORITHM_NUM = sizeof(BENCH_ALGORITHMS)/sizeof(BENCH_ALGORITHMS[0]);
+
+// Structure benchOptions: what the benchmark runs and how it reports
+struct benchOptions {
+	int families;		// graph types to run, bit 1 for type 1 and bit 2 for type 2
+	vector<int> sizes;	// vertex numbers to run
+	string algs;		// comma-separated algorithm names to run, empty for all
+	int queries;		// source-target pairs per graph
+	int warmup;		// untimed passes over the pairs before measuring
+	int reps;		// timed passes over the pairs
+	string format;		// text, csv or json
+	unsigned long long seed;	// seed of the graphs and the pairs
+	bool perf;		// whether to read hardware counters during the timed passes
+	const char *trace;	// file the phases of the linear-time algorithm are traced to, NULL if none
+};
+// END of benchOptions
+
+// Structure benchResult: measurements of one algorithm on one graph
+struct benchResult {
+	int type;		// graph type
+	int vertices;		// vertex number
+	int edges;		// edge number
+	const char *alg;	// algorithm name
+	int queries;		// timed queries
+	double prep;		// milliseconds of preprocessing, such as building the index
+	double mean;		// mean query latency in microseconds
+	double p50;		// median query latency in microseconds
+	double p99;		// 99th percentile query latency in microseconds
+	double qps;		// queries per second
+	int mismatches;		// queries whose answer differs from the reference or is not a path
+	double listBytes;	// bytes per edge of the linked-list graph
+	double csrBytes;	// bytes per edge of the CSR graph
+	size_t aux;		// bytes the algorithm keeps between queries, such as the index or its workspaces
+	size_t scratch;		// most scratch arena bytes in use during a query
+	long rss;		// peak resident set size of the process in kilobytes after the algorithm ran
+	double counters[PERF_COUNTER_NUM];	// hardware events per query, -1 if not counted
+	double ops[OP_KIND_NUM];	// basic operations per query, -1 if not counted
+};
+// END of benchResult
+
+// function to check whether name is in the comma-separated list, an empty list holds every name
+bool InNameList(const string &list, const char *name)
+{
+	if(list.empty()) {return true;}
+	string padded=","+list+",";
+	return padded.find(","+string(name)+",")!=string::npos;
+}
+
+// function to return the value at fraction q of sorted latencies, nearest-rank
+double Percentile(vector<double> &L, double q)
+{
+	if(L.empty()) {return 0;}
+	size_t k=size_t(ceil(q*L.size()));
+	return L[(k>0)?(k-1):0];
+}
+
+// function to return the peak resident set size of the process in kilobytes
+long PeakRSS()
+{
+	struct rusage u;
+	if(getrusage(RUSAGE_SELF, &u)!=0) {return -1;}
+	return u.ru_maxrss;
+}
+
+// function to run the selected algorithms on one graph and append their measurements to R
+// listBytes is the size of the linked-list graph C was built from
+// the timed passes of the linear-time algorithm are recorded in trace unless it is NULL
+void BenchGraph(benchOptions &O, csrGraph &C, size_t listBytes, int type, vector<benchResult> &R, perfCounters *P, phaseTrace *trace)
+{
+	int n=C.GetVertexNum();
+	int Q=O.queries;
+	int *S=new int[Q];
+	int *T=new int[Q];
+	int *ref=new int[Q];
+	randomStream Rq(O.seed, (unsigned long long)n*4+type);
+	for(int q=0;q<Q;q++) {
+		do {
+			S[q]=Rq.Below(n);
+			T[q]=Rq.Below(n);
+		} while(S[q]==T[q]);
+		ref[q]=-3;
+	}
+	queryWorkspace W(n);
+	queryWorkspace B(n);
+	scratchArena A;
+	benchState state;
+	state.W=&W;
+	state.B=&B;
+	state.A=&A;
+	state.I=NULL;
+	state.P=NULL;
+	int graph=TraceBegin(trace, (type==1)?"type1":"type2", -1, n, C.GetTotalEdgeNum());
+	for(int a=0;a<BENCH_ALGORITHM_NUM;a++) {
+		const benchAlgorithm &X=BENCH_ALGORITHMS[a];
+		if(!InNameList(O.algs, X.name) || (X.maxsize>0 && n>X.maxsize)) {continue;}
+		benchResult r;
+		r.type=type;
+		r.vertices=n;
+		r.edges=C.GetTotalEdgeNum();
+		r.alg=X.name;
+		r.queries=Q*O.reps;
+		r.prep=0;
+		r.mismatches=0;
+		r.listBytes=(r.edges>0)?double(listBytes)/r.edges:0;
+		r.csrBytes=(r.edges>0)?double(C.MemoryBytes())/r.edges:0;
+		if(X.index && state.I==NULL) {
+			double begin=WallMicros();
+			state.I=new bottleneckIndex(C);
+			r.prep=(WallMicros()-begin)/1000;
+		}
+		for(int w=0;w<O.warmup;w++) {
+			for(int q=0;q<Q;q++) {
+				int *Dad=X.run(C, S[q], T[q], state);
+				if(X.owned) {delete[] Dad;}
 			}
 		}
-		for(int i=0;i<nNew;i++) {
-			for(int j=i+1;j<nNew;j++) {
-				k=-1;
-				for(int v=0;v<n;v++) {
-					for(int u=v+1;u<n;u++) {
-						if((Com[v]==i && Com[u]==j) || (Com[v]==j && Com[u]==i)) {
-							if(Gsmall.GetWeight(v, u)>k) {
-							k=Gsmall.GetWeight(v, u);
-							P.a=v;
-							P.b=u;
-							P.w=k;
-							}
-						}
+		vector<double> L;
+		L.reserve(r.queries);
+		double total=0;
+		opCount::Clear();
+		A.ResetPeak();
+		state.P=trace;
+		for(int rep=0;rep<O.reps;rep++) {
+			for(int q=0;q<Q;q++) {
+				double begin=WallMicros();
+				int *Dad=X.run(C, S[q], T[q], state);
+				double us=WallMicros()-begin;
+				L.push_back(us);
+				total+=us;
+				if(rep==0) {
+					int band;
+					if(Dad==NULL) {
+						// only the bandwidth was timed, the index path is checked here
+						int *Path=state.I->Query(S[q], T[q]);
+						band=PathBandwidth(C, Path, S[q], T[q]);
+						if(band!=state.band) {band=-2;}
+						delete[] Path;
+					} else {
+						band=PathBandwidth(C, Dad, S[q], T[q]);
 					}
+					if(ref[q]==-3) {ref[q]=band;}
+					if(band!=ref[q] || band==-2) {r.mismatches++;}
 				}
-				if(k!=-1) {
-					Gnew.AddEdge(i, j, k);
-					NewE[i][j].a=P.a;
-					NewE[i][j].b=P.b;
-					NewE[i][j].w=P.w;
-				}
+				if(X.owned) {delete[] Dad;}
 			}
 		}
-		int* Dad=new int[n];
-		for(int i=0;i<n;i++) {Dad[i]=-1;}
-		if(Gnew.SearchEdge(Com[s], Com[t]) && (Gnew.GetComMaxWeight(Com[s], Com[t])==Gnew.GetWeight(Com[s], Com[t]))) {
-			int ap=((Com[s]<Com[t])?NewE[Com[s]][Com[t]].a:NewE[Com[t]][Com[s]].a);
-			int bp=((Com[s]<Com[t])?NewE[Com[s]][Com[t]].b:NewE[Com[t]][Com[s]].b);
-			int *Dads, *Dadt;
-			if(Com[s]==Com[ap]) {
-				Dads=BuildPath(Glarge, s, ap);
-				Dadt=BuildPath(Glarge, bp ,t);
-				int k=ap;
-				while(Dads[k]!=-1) {
-					Dad[k]=Dads[k];
-					k=Dads[k];
-				}
-				k=t;
-				while(Dadt[k]!=-1) {
-					Dad[k]=Dadt[k];
-					k=Dadt[k];
+		state.P=NULL;
+		r.scratch=A.GetPeakBytes();
+		// hardware counters get passes of their own, enabled only while the algorithm runs
+		if(P!=NULL) {
+			P->Clear();
+			for(int rep=0;rep<O.reps;rep++) {
+				for(int q=0;q<Q;q++) {
+					P->Start();
+					int *Dad=X.run(C, S[q], T[q], state);
+					P->Stop();
+					if(X.owned) {delete[] Dad;}
 				}
-				Dad[bp]=ap;
+			}
+		}
+		r.aux=X.index?state.I->MemoryBytes():X.workspaces*W.MemoryBytes();
+		r.rss=PeakRSS();
+		for(int i=0;i<PERF_COUNTER_NUM;i++) {
+			long long c=(P!=NULL)?P->GetCount(i):-1;
+			r.counters[i]=(c>=0)?double(c)/r.queries:-1;
+		}
+		for(int i=0;i<OP_KIND_NUM;i++) {
+			long long c=opCount::Get(opKind(i));
+			r.ops[i]=(c>=0)?double(c)/r.queries:-1;
+		}
+		sort(L.begin(), L.end());
+		r.mean=(r.queries>0)?total/r.queries:0;
+		r.p50=Percentile(L, 0.5);
+		r.p99=Percentile(L, 0.99);
+		r.qps=(total>0)?r.queries*1e6/total:0;
+		if(r.mismatches>0) {cerr << X.name<<" disagrees with the reference on "<<r.mismatches<<" queries"<<endl;}
+		R.push_back(r);
+	}
+	TraceEnd(trace, graph);
+	delete state.I;
+	delete[] S;
+	delete[] T;
+	delete[] ref;
+}
+
+// function to run the benchmark over every selected graph type and size, results are appended to R
+// return false if the trace file cannot be written
+bool RunBenchmark(benchOptions &O, vector<benchResult> &R)
+{
+	perfCounters *P=NULL;
+	if(O.perf) {
+		P=new perfCounters();
+		if(!P->IsAvailable()) {cerr << "Hardware counters are not available: "<<strerror(errno)<<endl;}
+	}
+	phaseTrace *trace=(O.trace!=NULL)?new phaseTrace():NULL;
+	for(int type=1;type<=2;type++) {
+		if(!(O.families&type)) {continue;}
+		for(size_t i=0;i<O.sizes.size();i++) {
+			int n=O.sizes[i];
+			undirGraph *G=new undirGraph(n);
+			if(type==1 && !G->BuildGraphType1(G1_DEGREE, MAX_WEIGHT, O.seed)) {
+				cerr << "No "<<G1_DEGREE<<"-regular graph on "<<n<<" vertices, skipped"<<endl;
+				delete G;
+				continue;
+			}
+			if(type==2) {G->BuildGraphType2(G2_PERCENT, MAX_WEIGHT, O.seed);}
+			csrGraph C(*G);
+			size_t listBytes=G->MemoryBytes();
+			delete G;
+			BenchGraph(O, C, listBytes, type, R, P, trace);
+		}
+	}
+	delete P;
+	bool saved=(trace==NULL || trace->Save(O.trace));
+	if(!saved) {cerr << "Cannot write trace to "<<O.trace<<endl;}
+	delete trace;
+	return saved;
+}
+
+// function to print benchmark results as an aligned table, CSV or JSON
+// hardware counter columns follow if perf is set, and operation count columns if built with SP_COUNT_OPS
+void PrintBenchmark(vector<benchResult> &R, const string &format, unsigned long long seed, bool perf)
+{
+	vector<string> columns;
+	const char *base[]={"graph", "vertices", "edges", "algorithm", "queries", "prep_ms",
+		"mean_us", "p50_us", "p99_us", "qps", "mismatches", "list_bpe", "csr_bpe", "aux_bytes",
+		"scratch_bytes", "peak_rss_kb"};
+	const int B=16;
+	for(int c=0;c<B;c++) {columns.push_back(base[c]);}
+	for(int i=0;perf && i<PERF_COUNTER_NUM;i++) {columns.push_back(perfCounters::GetName(i));}
+	for(int i=0;SP_COUNT_OPS && i<OP_KIND_NUM;i++) {columns.push_back(OpName(i));}
+	int P=perf?PERF_COUNTER_NUM:0;
+	int C=int(columns.size());
+	vector<int> widths(C, 12);
+	widths[0]=6;
+	widths[1]=9;
+	widths[3]=15;
+	widths[4]=8;
+	if(format=="json") {
+		cout << "{\"seed\": "<<seed<<", \"results\": ["<<endl;
+	} else if(format=="csv") {
+		cout << "seed,";
+		for(int c=0;c<C;c++) {cout << columns[c]<<((c+1<C)?",":"\n");}
+	} else {
+		cout << "Seed: "<<seed<<endl;
+		for(int c=0;c<C;c++) {cout << setw(widths[c])<<columns[c]<<((c+1<C)?" ":"\n");}
+	}
+	for(size_t i=0;i<R.size();i++) {
+		benchResult &r=R[i];
+		vector<ostringstream*> v;
+		for(int c=0;c<C;c++) {v.push_back(new ostringstream());}
+		*v[0]<<"type"<<r.type;
+		*v[1]<<r.vertices;
+		*v[2]<<r.edges;
+		*v[3]<<r.alg;
+		*v[4]<<r.queries;
+		*v[5]<<fixed<<setprecision(3)<<r.prep;
+		*v[6]<<fixed<<setprecision(3)<<r.mean;
+		*v[7]<<fixed<<setprecision(3)<<r.p50;
+		*v[8]<<fixed<<setprecision(3)<<r.p99;
+		*v[9]<<fixed<<setprecision(1)<<r.qps;
+		*v[10]<<r.mismatches;
+		*v[11]<<fixed<<setprecision(1)<<r.listBytes;
+		*v[12]<<fixed<<setprecision(1)<<r.csrBytes;
+		*v[13]<<r.aux;
+		*v[14]<<r.scratch;
+		*v[15]<<r.rss;
+		for(int c=B;c<C;c++) {
+			double x=(c-B<P)?r.counters[c-B]:r.ops[c-B-P];
+			if(x<0) {*v[c]<<((format=="json")?"null":"n/a");}
+			else {*v[c]<<fixed<<setprecision(1)<<x;}
+		}
+		for(int c=0;c<C;c++) {
+			string text=v[c]->str();
+			delete v[c];
+			if(format=="json") {
+				bool quoted=(c==0 || c==3);
+				cout << ((c==0)?"  {":"")<<"\""<<columns[c]<<"\": "<<(quoted?"\"":"")<<text<<(quoted?"\"":"")
+					<<((c+1<C)?", ":((i+1<R.size())?"},\n":"}\n"));
+			} else if(format=="csv") {
+				if(c==0) {cout << seed<<",";}
+				cout << text<<((c+1<C)?",":"\n");
 			} else {
-				Dads=BuildPath(Glarge, s, bp);
-				Dadt=BuildPath(Glarge, ap ,t);
-				int k=bp;
-				while(Dads[k]!=-1) {
-					Dad[k]=Dads[k];
-					k=Dads[k];
-				}
-				k=t;
-				while(Dadt[k]!=-1) {
-					Dad[k]=Dadt[k];
-					k=Dadt[k];
-				}
-				Dad[ap]=bp;			
+				cout << setw(widths[c])<<text<<((c+1<C)?" ":"\n");
 			}
-			delete(Dads);
-			delete(Dadt);
-		} else {
-			int *Dadnew = LinearAlgTrue(Gnew, Com[s], Com[t]);
-			int tp=t;
-			int comtp=Com[tp];
-			int comsp=Dadnew[comtp];
-			int *Dadt;
-			while(comtp!=Com[s]) {
-				int ap=((comsp<comtp) ? NewE[comsp][comtp].a : NewE[comtp][comsp].a);
-				int bp=((comsp<comtp) ? NewE[comsp][comtp].b : NewE[comtp][comsp].b);
-				if(comtp==Com[ap]) {
-					Dadt=BuildPath(Glarge, ap, tp);
-					int k=tp;
-					while(Dadt[k]!=-1) {
-						Dad[k]=Dadt[k];
-						k=Dadt[k];
-					}
-					Dad[ap]=bp;
-					tp=bp;
-					delete(Dadt);
-				} else {
-					Dadt=BuildPath(Glarge, bp, tp);
-					int k=tp;
-					while(Dadt[k]!=-1) {
-						Dad[k]=Dadt[k];
-						k=Dadt[k];
-					}
-					Dad[bp]=ap;
-					tp=ap;
-					delete(Dadt);
-				}
-				comtp=Com[tp];
-				comsp=Dadnew[comtp];
+		}
+	}
+	if(format=="json") {cout << "]}"<<endl;}
+}
+
+// function to read exactly len bytes from fd, false on end of input or error
+bool ReadFull(int fd, void *buf, size_t len)
+{
+	char *p=(char*)buf;
+	while(len>0) {
+		ssize_t r=read(fd, p, len);
+		if(r<0 && errno==EINTR) {continue;}
+		if(r<=0) {return false;}
+		p+=r;
+		len-=r;
+	}
+	return true;
+}
+
+// function to write exactly len bytes to fd, false on error
+bool WriteFull(int fd, const void *buf, size_t len)
+{
+	const char *p=(const char*)buf;
+	while(len>0) {
+		ssize_t r=write(fd, p, len);
+		if(r<0 && errno==EINTR) {continue;}
+		if(r<=0) {return false;}
+		p+=r;
+		len-=r;
+	}
+	return true;
+}
+
+// function to answer batches of queries read from in and write the bandwidths to out, until end of input
+// A batch is a uint32 count followed by count pairs of int32 source and target, the reply is count int32
+// bandwidths in the same order, all in native byte order. Returns 0 at end of input, -1 on a broken batch.
+int ServeQueries(int in, int out, queryService &S, queryAlg alg)
+{
+	uint32_t count;
+	int32_t *buf=new int32_t[2*SERVER_BATCH];
+	query *Q=new query[SERVER_BATCH];
+	int result=0;
+	while(ReadFull(in, &count, sizeof(count))) {
+		while(count>0 && result==0) {
+			int len=(count<(uint32_t)SERVER_BATCH)?int(count):SERVER_BATCH;
+			if(!ReadFull(in, buf, 2*len*sizeof(int32_t))) {
+				result=-1;
+				break;
 			}
-			Dadt=BuildPath(Glarge, s, tp);
-			int k=tp;
-			while(Dadt[k]!=-1) {
-				Dad[k]=Dadt[k];
-				k=Dadt[k];
+			for(int i=0;i<len;i++) {
+				Q[i].s=buf[2*i];
+				Q[i].t=buf[2*i+1];
+				Q[i].alg=alg;
 			}
-			delete(Dadnew);
+			S.Run(Q, len);
+			for(int i=0;i<len;i++) {buf[i]=Q[i].band;}
+			if(!WriteFull(out, buf, len*sizeof(int32_t))) {result=-1;}
+			count-=len;
 		}
-		return Dad;
+		if(result!=0) {break;}
 	}
+	delete[] buf;
+	delete[] Q;
+	return result;
 }
 
-// function to display the max-bandwidth path for a given path and its max bandwidth
-void Display(int *Dad, undirGraph &G, int source, int target)
+// function to answer queries from every client connecting to a Unix domain socket at path, one client at a time
+int ServeSocket(const char *path, queryService &S, queryAlg alg)
 {
-	int stack[G.GetVertexNum()];
-	int stacklen=0;
-	int h=target;
-	while(h!=-1) {
-		stack[stacklen++]=h;
-		h=Dad[h];
+	struct sockaddr_un addr;
+	if(strlen(path)>=sizeof(addr.sun_path)) {
+		cerr << "Socket path too long: "<<path<<endl;
+		return -1;
+	}
+	int fd=socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd<0) {
+		cerr << "Cannot create socket: "<<strerror(errno)<<endl;
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	strcpy(addr.sun_path, path);
+	// only a stale socket is replaced, never a file that happens to be at path
+	struct stat st;
+	if(lstat(path, &st)==0) {
+		if(!S_ISSOCK(st.st_mode)) {
+			cerr << "Not a socket, left untouched: "<<path<<endl;
+			close(fd);
+			return -1;
+		}
+		unlink(path);
 	}
-	int a=stack[--stacklen];
-	int b=stack[--stacklen];
-	int maxband=G.GetWeight(a, b);
-	cout << a<<"-";
-	while(stacklen) {
-		cout <<b<<"-";
-		if(G.GetWeight(a,b)<maxband) {maxband=G.GetWeight(a,b);}
-		a=b;
-		b=stack[--stacklen];
+	struct stat own;
+	if(bind(fd, (struct sockaddr*)&addr, sizeof(addr))<0 || listen(fd, SOMAXCONN)<0 || lstat(path, &own)!=0) {
+		cerr << "Cannot listen on "<<path<<": "<<strerror(errno)<<endl;
+		close(fd);
+		return -1;
+	}
+	cerr << "Listening on "<<path<<endl;
+	while(true) {
+		int client=accept(fd, NULL, NULL);
+		if(client<0) {
+			if(errno==EINTR || errno==ECONNABORTED) {continue;}
+			cerr << "Cannot accept: "<<strerror(errno)<<endl;
+			break;
+		}
+		if(ServeQueries(client, client, S, alg)!=0) {cerr << "Dropped a client after a broken batch"<<endl;}
+		close(client);
 	}
-	if(G.GetWeight(a,b)<maxband) {maxband=G.GetWeight(a,b);} cout<<b;
-	cout <<endl<<"Max Bandwidth: "<<maxband<<endl;
+	close(fd);
+	if(lstat(path, &st)==0 && S_ISSOCK(st.st_mode) && st.st_dev==own.st_dev && st.st_ino==own.st_ino) {unlink(path);}
+	return -1;
 }
 
-// function to display the max bandwidth of a given path
-void Display2(int *Dad, undirGraph &G, int source, int target)
+// function to parse the name of a query algorithm, false if unknown
+bool ParseQueryAlg(const char *name, queryAlg &alg)
 {
-	int stack[G.GetVertexNum()];
-	int stacklen=0;
-	int h=target;
-	while(h!=-1) {
-		stack[stacklen++]=h;
-		h=Dad[h];
-	}
-	int a=stack[--stacklen];
-	int b=stack[--stacklen];
-	int maxband=G.GetWeight(a, b);
-	while(stacklen) {
-		if(G.GetWeight(a,b)<maxband) {maxband=G.GetWeight(a,b);}
-		a=b;
-		b=stack[--stacklen];
-	}
-	if(G.GetWeight(a,b)<maxband) {maxband=G.GetWeight(a,b);} //cout<<b;
-	cout <<"Max Bandwidth: "<<maxband<<endl<<endl;
-}
-
-// function to count runtime
-static double diffclock(clock_t clock1,clock_t clock2)
-{
-    double diffticks=clock1-clock2;
-    double diffms=(diffticks)/(CLOCKS_PER_SEC/1000);
-    return diffms;
-}
-
-// function to test 3 routing algorithms for max-bandwidth problem
-void TestRoutingAlg()
-{	
-	srand(time(0));
-	clock_t begin, end;
-	double seconds;
-	int source, target;
-	int *Dad, *Dad2, *Dad3;	
-	undirGraph G1(VMAX_NUM), G2(VMAX_NUM);
-	cout << "------Start to test routing algorithms------"<<endl<<endl;
-	for(int q=0;q<5;q++) {
-		cout << "Round "<<q+1<<endl<<endl;
-		G1.BuildGraphType1(G1_DEGREE, MAX_WEIGHT);
-		cout << "Build graph type1"<<endl;
-		G2.BuildGraphType2(G2_PERCENT, MAX_WEIGHT);
-		cout << "Build graph tupe2"<<endl<<endl;
-		for(int c=0;c<5;c++) {
-			undirGraph G3=G1;
-			undirGraph G4=G2;
-			do {
-				source=rand() % VMAX_NUM;
-				target=rand() % VMAX_NUM;
-			} while(source==target)	;
-			cout << "Randomly pick source-destination pair : "<<source<<", "<<target<<endl<<endl;
-			G3.AddExtraEdgesForTest(source, target, MAX_WEIGHT);
-			cout << "Testing algorithms on graph type 1 from "<<source<<" to " <<target<<endl<<endl;
-
-			begin = clock();
-			Dad=Dijkstra(G3, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Dijkstra Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Dijkstra Algorithm: "<<endl;
-			Display2(Dad, G3, source, target);
-			delete Dad;
-
-			begin = clock();
-			Dad2=ModifiedDijkstra(G3, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Modified Dijkstra Algorithm with Max Heap: "<<seconds<<" ms"<< endl;
-			cout << "Result of Modified Dijkstra Algorithm with Max Heap: "<<endl;
-			Display2(Dad2, G3, source, target);
-			delete Dad2;
-
-			begin = clock();
-			Dad3=Kruskal(G3, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout << "Runtim of Kruskal Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Kruskal Algorithm: "<<endl;
-			Display2(Dad3, G3, source, target);
-			delete Dad3;		
-
-			G3.CleanAllEdges();
-
-			G4.AddExtraEdgesForTest(source, target, MAX_WEIGHT);
-			cout << "Testing algorithms on graph type 2 from "<<source<<" to " <<target<<endl<<endl;
-
-			begin = clock();
-			Dad=Dijkstra(G4, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Dijkstra Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Dijkstra Algorithm: "<<endl;
-			Display2(Dad, G4, source, target);
-			delete Dad;
-
-			begin = clock();
-			Dad2=ModifiedDijkstra(G4, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Modified Dijkstra Algorithm with Max Heap: "<<seconds<<" ms"<< endl;
-			cout << "Result of Modified Dijkstra Algorithm with Max Heap: "<<endl;
-			Display2(Dad2, G4, source, target);
-			delete Dad2;
-		
-			begin = clock();
-			Dad3=Kruskal(G4, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout << "Runtim of Kruskal Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Kruskal Algorithm: "<<endl;
-			Display2(Dad3, G4, source, target);
-			delete Dad3;
-
-			G4.CleanAllEdges();
-		}
-		G1.CleanAllEdges();G2.CleanAllEdges();
-	}
-}
-
-// function to test 4 algorithms for max-bandwidth problem
-// 3 algorithms + linear-time algorithm
-void TestRoutingAlgExt()
-{	
-	srand(time(0));
-	clock_t begin, end;
-	double seconds;
-	int source, target;
-	int *Dad, *Dad2, *Dad3, *Dad4;	
-	undirGraph G1(VMAX_NUM), G2(VMAX_NUM);
-	cout << "------Start to test routing algorithms------"<<endl<<endl;
-	for(int q=0;q<5;q++) {
-		cout << "Round "<<q+1<<endl<<endl;
-		G1.BuildGraphType1(G1_DEGREE, MAX_WEIGHT);
-		cout << "Build graph type1"<<endl;
-		G2.BuildGraphType2(G2_PERCENT, MAX_WEIGHT);
-		cout << "Build graph tupe2"<<endl<<endl;
-		for(int c=0;c<5;c++) {
-			undirGraph G3=G1;
-			undirGraph G4=G2;
-			do {
-				source=rand() % VMAX_NUM;
-				target=rand() % VMAX_NUM;
-			} while(source==target)	;
-			cout << "Randomly pick source-destination pair : "<<source<<", "<<target<<endl<<endl;
-			G3.AddExtraEdgesForTest(source, target, MAX_WEIGHT);
-			cout << "Testing algorithms on graph type 1 from "<<source<<" to " <<target<<endl<<endl;
-
-			begin = clock();
-			Dad=Dijkstra(G3, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Dijkstra Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Dijkstra Algorithm: "<<endl;
-			Display2(Dad, G3, source, target);
-			delete Dad;
-
-			begin = clock();
-			Dad2=ModifiedDijkstra(G3, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Modified Dijkstra Algorithm with Max Heap: "<<seconds<<" ms"<< endl;
-			cout << "Result of Modified Dijkstra Algorithm with Max Heap: "<<endl;
-			Display2(Dad2, G3, source, target);
-			delete Dad2;
-
-			begin = clock();
-			Dad3=Kruskal(G3, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout << "Runtim of Kruskal Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Kruskal Algorithm: "<<endl;
-			Display2(Dad3, G3, source, target);
-			delete Dad3;		
-
-			begin = clock();
-			Dad4=LinearAlgTrue(G3, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout << "Runtim of Linear Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Linear Algorithm: "<<endl;
-			Display2(Dad4, G3, source, target);
-			delete Dad4;		
-
-			G3.CleanAllEdges();
-
-			G4.AddExtraEdgesForTest(source, target, MAX_WEIGHT);
-			cout << "Testing algorithms on graph type 2 from "<<source<<" to " <<target<<endl<<endl;
-
-			begin = clock();
-			Dad=Dijkstra(G4, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Dijkstra Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Dijkstra Algorithm: "<<endl;
-			Display2(Dad, G4, source, target);
-			delete Dad;
-
-			begin = clock();
-			Dad2=ModifiedDijkstra(G4, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout<< "Runtim of Modified Dijkstra Algorithm with Max Heap: "<<seconds<<" ms"<< endl;
-			cout << "Result of Modified Dijkstra Algorithm with Max Heap: "<<endl;
-			Display2(Dad2, G4, source, target);
-			delete Dad2;
-		
-			begin = clock();
-			Dad3=Kruskal(G4, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout << "Runtim of Kruskal Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Kruskal Algorithm: "<<endl;
-			Display2(Dad3, G4, source, target);
-			delete Dad3;
-
-			begin = clock();
-			Dad4=LinearAlgTrue(G4, source, target);
-			end = clock();
-			seconds = diffclock(end, begin);
-			cout << "Runtim of Linear Algorithm: "<<seconds<<" ms"<< endl;
-			cout << "Result of Linear Algorithm: "<<endl;
-			Display2(Dad4, G4, source, target);
-			delete Dad4;
-
-			G4.CleanAllEdges();
-		}
-		G1.CleanAllEdges();G2.CleanAllEdges();
-	}
-}
-
-// Main function
+	const char *names[]={"dijkstra", "heap", "radix", "bidirectional", "index"};
+	for(int i=0;i<5;i++) {
+		if(strcmp(name, names[i])==0) {
+			alg=queryAlg(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Structure serverOptions: command line options of the query server
+struct serverOptions {
+	bool server;		// whether to answer queries on stdin and stdout
+	const char *socket;	// path of the Unix domain socket to answer queries on, NULL if none
+	const char *snapshot;	// snapshot file to map instead of building a graph, NULL if none
+	const char *edges;	// edge-list file to load instead of building a graph, NULL if none
+	const char *save;	// snapshot file to save the graph to before answering, NULL if none
+	int type;		// type of the random graph to build
+	int size;		// vertex number of the random graph to build
+	queryAlg alg;		// algorithm answering the queries
+	int threads;		// number of worker threads, 0 for all processors
+	unsigned long long seed;	// seed of the random graph
+};
+// END of serverOptions
+
+// function to build, load or map a graph once and answer queries on it until the input ends
+int RunServer(serverOptions &O)
+{
+	signal(SIGPIPE, SIG_IGN);
+	double begin=WallMicros();
+	graphSnapshot *snap=NULL;
+	csrGraph *C=NULL;
+	bottleneckIndex *I=NULL;
+	bool owned=true;
+	if(O.snapshot!=NULL) {
+		snap=new graphSnapshot(O.snapshot);
+		if(!snap->IsValid()) {
+			cerr << "Cannot use snapshot "<<O.snapshot<<endl;
+			delete snap;
+			return -1;
+		}
+		C=snap->GetGraph();
+		I=snap->GetIndex();
+		owned=(I==NULL);
+		cerr << "Snapshot "<<O.snapshot;
+	} else if(O.edges!=NULL) {
+		undirGraph *G=LoadGraph(O.edges);
+		if(G==NULL) {return -1;}
+		C=new csrGraph(*G);
+		delete G;
+		cerr << "Edge list "<<O.edges;
+	} else {
+		undirGraph G(O.size);
+		if(O.type==1 && !G.BuildGraphType1(G1_DEGREE, MAX_WEIGHT, O.seed)) {
+			cerr << "No "<<G1_DEGREE<<"-regular graph on "<<O.size<<" vertices with seed "<<O.seed<<endl;
+			return -1;
+		}
+		if(O.type==2) {G.BuildGraphType2(G2_PERCENT, MAX_WEIGHT, O.seed);}
+		C=new csrGraph(G);
+		cerr << "Graph type"<<O.type<<" of seed "<<O.seed;
+	}
+	if(I==NULL && O.alg==QUERY_INDEX) {I=new bottleneckIndex(*C);}
+	cerr << " with "<<C->GetVertexNum()<<" vertices and "<<C->GetTotalEdgeNum()<<" edges ready in "
+		<<(WallMicros()-begin)/1000<<" ms"<<endl;
+	cerr << "Graph takes "<<C->MemoryBytes()<<" bytes";
+	if(I!=NULL) {cerr << ", index "<<I->MemoryBytes()<<" bytes";}
+	cerr << endl;
+	int result=0;
+	if(O.save!=NULL && !SaveSnapshot(O.save, *C, I)) {
+		cerr << "Cannot save snapshot "<<O.save<<endl;
+		result=-1;
+	}
+	if(result==0 && (O.server || O.socket!=NULL)) {
+		queryService S(*C, I, O.threads);
+		if(O.socket!=NULL) {result=ServeSocket(O.socket, S, O.alg);}
+		else {result=ServeQueries(0, 1, S, O.alg);}
+	}
+	if(owned) {delete I;}
+	if(snap!=NULL) {delete snap;}
+	else {delete C;}
+	return result;
+}
+
+// function to print the command line options
+void Usage(const char *program)
+{
+	cerr << "Usage: "<<program<<" [--server | --socket PATH] [--graph type1|type2] [--size N] [--seed S]"<<endl
+		<< "       [--edges FILE | --snapshot FILE] [--save FILE] [--alg dijkstra|heap|radix|bidirectional|index] [--threads K]"<<endl
+		<< "Without --server, --socket or --save the algorithms are benchmarked on random graphs:"<<endl
+		<< "       [--graph type1|type2] [--sizes N,N...] [--algs NAME,NAME...] [--queries Q] [--warmup W] [--reps R]"<<endl
+		<< "       [--format text|csv|json] [--perf] [--trace FILE] [--seed S]"<<endl
+		<< "Benchmarked algorithms:";
+	for(int a=0;a<BENCH_ALGORITHM_NUM;a++) {cerr << " "<<BENCH_ALGORITHMS[a].name;}
+	cerr << endl;
+}
+
 int main (int argc, char *argv[]) {
-	TestRoutingAlg();
-	//TestRoutingAlgExt();
-	// before using TestRoutingAlgExt(), please make sure the value of VMAX_NUM is suitable for testing
-	// the runtime of linear-time algorithm in graph with large vertex number is unaffordable 
-	return 1;
+	serverOptions O;
+	O.server=false;
+	O.socket=NULL;
+	O.snapshot=NULL;
+	O.edges=NULL;
+	O.save=NULL;
+	O.type=1;
+	O.size=VMAX_NUM;
+	O.alg=QUERY_INDEX;
+	O.threads=0;
+	O.seed=time(0);
+	benchOptions B;
+	B.families=3;
+	B.sizes.push_back(VMAX_NUM);
+	B.queries=BENCH_QUERIES;
+	B.warmup=1;
+	B.reps=3;
+	B.format="text";
+	B.perf=false;
+	B.trace=NULL;
+	for(int i=1;i<argc;i++) {
+		string arg=argv[i];
+		bool more=(i+1<argc);
+		if(arg=="--server") {O.server=true;}
+		else if(arg=="--socket" && more) {O.socket=argv[++i];}
+		else if(arg=="--snapshot" && more) {O.snapshot=argv[++i];}
+		else if(arg=="--save" && more) {O.save=argv[++i];}
+		else if(arg=="--edges" && more) {O.edges=argv[++i];}
+		else if(arg=="--graph" && more) {
+			string g=argv[++i];
+			if(g=="type1") {O.type=1;}
+			else if(g=="type2") {O.type=2;}
+			else {Usage(argv[0]); return 1;}
+			B.families=O.type;
+		}
+		else if(arg=="--sizes" && more) {
+			B.sizes.clear();
+			stringstream list(argv[++i]);
+			string item;
+			while(getline(list, item, ',')) {
+				if(atoi(item.c_str())>1) {B.sizes.push_back(atoi(item.c_str()));}
+			}
+		}
+		else if(arg=="--algs" && more) {B.algs=argv[++i];}
+		else if(arg=="--perf") {B.perf=true;}
+		else if(arg=="--trace" && more) {B.trace=argv[++i];}
+		else if(arg=="--queries" && more) {B.queries=max(1, atoi(argv[++i]));}
+		else if(arg=="--warmup" && more) {B.warmup=max(0, atoi(argv[++i]));}
+		else if(arg=="--reps" && more) {B.reps=max(1, atoi(argv[++i]));}
+		else if(arg=="--format" && more) {
+			B.format=argv[++i];
+			if(B.format!="text" && B.format!="csv" && B.format!="json") {Usage(argv[0]); return 1;}
+		}
+		else if(arg=="--size" && more) {O.size=atoi(argv[++i]);}
+		else if(arg=="--threads" && more) {O.threads=atoi(argv[++i]);}
+		else if(arg=="--seed" && more) {O.seed=strtoull(argv[++i], NULL, 10);}
+		else if(arg=="--alg" && more) {
+			if(!ParseQueryAlg(argv[++i], O.alg)) {Usage(argv[0]); return 1;}
+		}
+		else {Usage(argv[0]); return 1;}
+	}
+	if(O.server || O.socket!=NULL || O.save!=NULL) {
+		if(O.snapshot==NULL && O.edges==NULL && ((O.type==1 && O.size<=G1_DEGREE) || O.size<2)) {
+			cerr << "Graph type"<<O.type<<" needs more than "<<((O.type==1)?G1_DEGREE:1)<<" vertices"<<endl;
+			return 1;
+		}
+		return (RunServer(O)==0)?0:1;
+	}
+	if(O.edges!=NULL || O.snapshot!=NULL) {
+		cerr << "--edges and --snapshot need --server, --socket or --save"<<endl;
+		return 1;
+	}
+	B.seed=O.seed;
+	vector<benchResult> R;
+	bool traced=RunBenchmark(B, R);
+	PrintBenchmark(R, B.format, B.seed, B.perf);
+	return traced?0:1;
 } 